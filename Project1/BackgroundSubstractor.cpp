@@ -1,4 +1,5 @@
 #include "BackgroundSubstractor.h"
+#include "BlockFeatureExtractor.h"
 
 
 BackgroundSubstractor::BackgroundSubstractor()
@@ -8,38 +9,37 @@ BackgroundSubstractor::BackgroundSubstractor()
 
 void BackgroundSubstractor::correctInnerBlocksEstimatedAsBackground(Image* image)
 {
-    cv::Mat backgroundMask = image->getBackgroundMask();
-    cv::Mat validityMask = cv::Mat::zeros(backgroundMask.size(), CV_8U);
+    BlockGrid<unsigned char> backgroundMask(image->getBackgroundMask());
+    BlockGrid<unsigned char> validityMask(backgroundMask.getWidth(), backgroundMask.getHeight(), NOT_VALID);
 
-    for (int blockX = 0; blockX < backgroundMask.cols; blockX++)
+    //validity spreads in visiting order, blocks are visited column by column
+    for (int blockX = 0; blockX < backgroundMask.getWidth(); blockX++)
     {
-        for (int blockY = 0; blockY < backgroundMask.rows; blockY++)
+        for (int blockY = 0; blockY < backgroundMask.getHeight(); blockY++)
         {
             //is bg and border ==> valid
-            if (Image::isElementBorderElementOfMat(blockX, blockY, backgroundMask)
-                && (int)backgroundMask.at<unsigned char>(blockY, blockX) == BACKGROUND)
+            if (backgroundMask.isBorder(blockX, blockY) && backgroundMask(blockX, blockY) == BACKGROUND)
             {
-                validityMask.at<unsigned char>(blockY, blockX) = VALID;
+                validityMask(blockX, blockY) = VALID;
             }
             //not border ==> has to have valid bg neigh
-            else if ((int)backgroundMask.at<unsigned char>(blockY, blockX) == BACKGROUND)
+            else if (backgroundMask(blockX, blockY) == BACKGROUND)
             {
-				if(hasBackgroundNeighbor(blockX, blockY, backgroundMask, validityMask))
+				if(validityMask.countInNeighborhood(blockX, blockY, VALID) > 0)
 				{
-					validityMask.at<unsigned char>(blockY, blockX) = VALID;
+					validityMask(blockX, blockY) = VALID;
 				}
             }
         }
     }
 
-    for (int blockX = 0; blockX < backgroundMask.cols; blockX++)
+    for (int blockY = 0; blockY < backgroundMask.getHeight(); blockY++)
     {
-        for (int blockY = 0; blockY < backgroundMask.rows; blockY++)
+        for (int blockX = 0; blockX < backgroundMask.getWidth(); blockX++)
         {
-            if ((int)backgroundMask.at<unsigned char>(blockY, blockX) == BACKGROUND
-                && (int)validityMask.at<unsigned char>(blockY, blockX) == NOT_VALID)
+            if (backgroundMask(blockX, blockY) == BACKGROUND && validityMask(blockX, blockY) == NOT_VALID)
             {
-                backgroundMask.at<unsigned char>(blockY, blockX) = FOREGROUND;
+                backgroundMask(blockX, blockY) = FOREGROUND;
             }
         }
     }
@@ -48,141 +48,97 @@ void BackgroundSubstractor::correctInnerBlocksEstimatedAsBackground(Image* image
 
 void BackgroundSubstractor::estimateBackgroundAreaFromVariance(Image* image)
 {
-    cv::Mat img = image->getProcessedImage();
-    int blockSize = image->getBlockSize();
-    cv::Mat backgroundMask = cv::Mat::zeros(img.rows / blockSize, img.cols / blockSize, CV_8U);
-
-    for (int blockX = 0; blockX < backgroundMask.cols; blockX++)
+    //statistics are missing when background is estimated outside of pipeline
+    if (image->getBlockStatistics().variance.empty())
     {
-        for (int blockY = 0; blockY < backgroundMask.rows; blockY++)
-        {
-            //calculate variance in block
-            cv::Scalar meanSc, devSc;
-            double mean, stdDev, variance;
+        BlockFeatureExtractor().extractIntensityStatistics(image);
+    }
 
-            //subduct only the current block
-            cv::Mat block = img(cv::Rect(blockX * blockSize, blockY * blockSize, blockSize, blockSize));
-            meanStdDev(block, meanSc, devSc);
-            mean = meanSc.val[0];
-            stdDev = devSc.val[0];
-            variance = pow(stdDev, 2);
+    const BlockGrid<double>& blockVariance = image->getBlockStatistics().variance;
+    BlockGrid<unsigned char> backgroundMask(blockVariance.getWidth(), blockVariance.getHeight(), FOREGROUND);
 
-            //estimate bg by gray intensity variance in block
-            if (variance < this->backgroundTreshold)
-            {
-                backgroundMask.at<unsigned char>(blockY, blockX) = BACKGROUND;
-            }
+    for (int blockY = 0; blockY < backgroundMask.getHeight(); blockY++)
+    {
+        const double* varianceRow = blockVariance.row(blockY);
+        unsigned char* maskRow = backgroundMask.row(blockY);
 
-            //border blocks have higher probability to be bg
-            if (Image::isElementBorderElementOfMat(blockX, blockY, backgroundMask))
+        for (int blockX = 0; blockX < backgroundMask.getWidth(); blockX++)
+        {
+            //estimate bg by gray intensity variance in block
+            if (varianceRow[blockX] < this->backgroundTreshold)
             {
-                if (variance < this->backgroundTreshold)
-                {
-                    backgroundMask.at<unsigned char>(blockY, blockX) = BACKGROUND;
-                }
+                maskRow[blockX] = BACKGROUND;
             }
         }
     }
 
-    image->setBackgroundMask(backgroundMask);
+    image->setBackgroundMask(backgroundMask.getMat());
     interpolateBackgroundMask(image, 3);
     correctInnerBlocksEstimatedAsBackground(image);
+
+    //downstream stages iterate only over foreground blocks
+    image->setForegroundBlocks(ForegroundBlockIndex(image->getBackgroundMask()));
 }
 
 
 void BackgroundSubstractor::interpolateBackgroundMask(Image* image, int cycles)
 {
-    cv::Mat backgroundMask = image->getBackgroundMask();
+    BlockGrid<unsigned char> backgroundMask(image->getBackgroundMask());
 
     //number of interpolation cycles 
     for (int cycle = 0; cycle < cycles; cycle++)
     {
-        //all blocks (i,j)
-        for (int i = 0; i < backgroundMask.cols; i++)
+        //all blocks (i,j), mask is updated in place so blocks are visited column by column
+        for (int i = 0; i < backgroundMask.getWidth(); i++)
         {
-            for (int j = 0; j < backgroundMask.rows; j++)
+            for (int j = 0; j < backgroundMask.getHeight(); j++)
             {
-                int bgBlocksInNeigh = 0;
-
-                //neighbourhood blocks (i+u,j+v)
-                for (int u = -1; u <= 1; u++)
-                {
-                    for (int v = -1; v <= 1; v++)
-                    {
-                        if (Image::isElementInMatSizeRange(i + u, j + v, backgroundMask))
-                        {
-                            if ((int)backgroundMask.at<unsigned char>(j + v, i + u) == BACKGROUND)
-                            {
-                                bgBlocksInNeigh++;
-                            }
-                        }
-                    }
-                }
+                int bgBlocksInNeigh = backgroundMask.countInNeighborhood(i, j, BACKGROUND);
 
-                if (Image::isElementBorderElementOfMat(i, j, backgroundMask))
+                if (backgroundMask.isBorder(i, j))
                 {
                     if (bgBlocksInNeigh > 1)
                     {
                         //is background too, on the border if both neigh blocks are bg
-                        backgroundMask.at<unsigned char>(j, i) = BACKGROUND;
+                        backgroundMask(i, j) = BACKGROUND;
                     }
                 }
 
                 else if (bgBlocksInNeigh < 4)
                 {
                     //is not background, too little neighbors are not background neither
-                    backgroundMask.at<unsigned char>(j, i) = FOREGROUND;
+                    backgroundMask(i, j) = FOREGROUND;
                 }
 
                 else if (bgBlocksInNeigh > 4)
                 {
                     //is background, most of neighbors are background either
-                    backgroundMask.at<unsigned char>(j, i) = BACKGROUND;
+                    backgroundMask(i, j) = BACKGROUND;
                 }
             }
         }
     }
 
-    image->setBackgroundMask(backgroundMask);
+    image->setBackgroundMask(backgroundMask.getMat());
 }
 
 
 bool BackgroundSubstractor::hasBackgroundNeighbor(int blockX, int blockY, const cv::Mat& backgroundMask)
 {
-	bool backgroundInNeigh = false;
-
-	for (int x = blockX - 1; x <= blockX + 1; x++)
+	for (int y = blockY - 1; y <= blockY + 1; y++)
 	{
-		for (int y = blockY - 1; y <= blockY + 1; y++)
-		{
-			if (Image::isElementInMatSizeRange(x, y, backgroundMask))
-			{
-				if (backgroundMask.at<unsigned char>(y, x) == BACKGROUND)
-					backgroundInNeigh = true;
-			}
-		}
-	}
-
-	return backgroundInNeigh;
-}
-
+		if (y < 0 || y >= backgroundMask.rows)
+			continue;
 
-bool BackgroundSubstractor::hasBackgroundNeighbor(int blockX, int blockY, const cv::Mat backgroundMask,
-	const cv::Mat validityMask) {
-	int validBlocksInNeigh = 0;
-
-	//neighbourhood blocks (i+u,j+v)
-	for (int u = -1; u <= 1; u++) {
-		for (int v = -1; v <= 1; v++) {
-			if (Image::isElementInMatSizeRange(blockX + u, blockY + v, backgroundMask)) {
-				if ((int)validityMask.at<unsigned char>(blockY + v, blockX + u) == VALID) {
-					validBlocksInNeigh++;
-				}
-			}
+		const unsigned char* maskRow = backgroundMask.ptr<unsigned char>(y);
+		for (int x = blockX - 1; x <= blockX + 1; x++)
+		{
+			if (x >= 0 && x < backgroundMask.cols && maskRow[x] == BACKGROUND)
+				return true;
 		}
 	}
 
-	return validBlocksInNeigh > 0;
+	return false;
 }
 
 
@@ -190,15 +146,19 @@ cv::Mat BackgroundSubstractor::colorBackgroundAreasWhite(Image* image)
 {
     cv::Mat finalImage;
     image->getProcessedImage().copyTo(finalImage);
+    BlockGrid<unsigned char> backgroundMask(image->getBackgroundMask());
     int blockSize = image->getBlockSize();
 
-    for (int i = 0; i < finalImage.cols; i++)
+    for (int j = 0; j < finalImage.rows; j++)
     {
-        for (int j = 0; j < finalImage.rows; j++)
+        unsigned char* pixelRow = finalImage.ptr<unsigned char>(j);
+        const unsigned char* blockRow = backgroundMask.row(j / blockSize);
+
+        for (int i = 0; i < finalImage.cols; i++)
         {
-            if (image->getBackgroundMask().at<unsigned char>(j / blockSize, i / blockSize) == BACKGROUND)
+            if (blockRow[i / blockSize] == BACKGROUND)
             {
-                finalImage.at<unsigned char>(j, i) = 255;
+                pixelRow[i] = 255;
             }
         }
     }
@@ -209,22 +169,18 @@ cv::Mat BackgroundSubstractor::colorBackgroundAreasWhite(Image* image)
 
 cv::Mat BackgroundSubstractor::drawBackground(Image* image)
 {
-    cv::Mat finalImage;
-    image->getProcessedImage().copyTo(finalImage);
+    cv::Mat finalImage(image->getSize(), CV_8U);
+    BlockGrid<unsigned char> backgroundMask(image->getBackgroundMask());
     int blockSize = image->getBlockSize();
 
-    for (int i = 0; i < finalImage.cols; i++)
+    for (int j = 0; j < finalImage.rows; j++)
     {
-        for (int j = 0; j < finalImage.rows; j++)
+        unsigned char* pixelRow = finalImage.ptr<unsigned char>(j);
+        const unsigned char* blockRow = backgroundMask.row(j / blockSize);
+
+        for (int i = 0; i < finalImage.cols; i++)
         {
-            if (image->getBackgroundMask().at<unsigned char>(j / blockSize, i / blockSize) == BACKGROUND)
-            {
-                finalImage.at<unsigned char>(j, i) = 0;
-            }
-			else
-			{
-				finalImage.at<unsigned char>(j, i) = 255;
-			}
+            pixelRow[i] = (blockRow[i / blockSize] == BACKGROUND) ? 0 : 255;
         }
     }
 
@@ -232,24 +188,14 @@ cv::Mat BackgroundSubstractor::drawBackground(Image* image)
 }
 
 
-bool BackgroundSubstractor::isBackgroundBlock(int blockX, int blockY, cv::Mat backgroundMask)
+bool BackgroundSubstractor::isBackgroundBlock(int blockX, int blockY, const cv::Mat& backgroundMask)
 {
-    if ((int)backgroundMask.at<unsigned char>(blockY, blockX) == BACKGROUND)
-    {
-        return true;
-    }
-    return false;
+    return backgroundMask.ptr<unsigned char>(blockY)[blockX] == BACKGROUND;
 }
 
 
 bool BackgroundSubstractor::isBackgroundPixel(int pixelX, int pixelY, Image* image)
 {
-    cv::Mat backgroundMask = image->getBackgroundMask();
     int blockSize = image->getBlockSize();
-
-    if ((int)backgroundMask.at<unsigned char>(pixelY / blockSize, pixelX / blockSize) == BACKGROUND)
-    {
-        return true;
-    }
-    return false;
+    return !image->getForegroundBlocks().isForeground(pixelX / blockSize, pixelY / blockSize);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Image.h"
+#include "BlockGrid.h"
 
 #define NOT_VALID 0
 #define VALID 1
@@ -17,9 +18,8 @@ public:
     void interpolateBackgroundMask(Image* image, int cycles);
 	cv::Mat colorBackgroundAreasWhite(Image* image);
 
-    static bool isBackgroundBlock(int blockX, int blockY, cv::Mat backgroundMask);
+    static bool isBackgroundBlock(int blockX, int blockY, const cv::Mat& backgroundMask);
     static bool isBackgroundPixel(int pixelX, int pixelY, Image* image);
-	static bool hasBackgroundNeighbor(int blockX, int blockY, const cv::Mat backgroundMask, const cv::Mat validityMask);
     static bool hasBackgroundNeighbor(int blockX, int blockY, const cv::Mat& backgroundMask);
     static cv::Mat drawBackground(Image* image);
 };
@@ -0,0 +1,216 @@
+#include "BlockFeatureExtractor.h"
+#include "OrientationsEstimator.h"
+#include <algorithm>
+
+
+BlockFeatureExtractor::BlockFeatureExtractor()
+{
+}
+
+
+/**
+ * mean, variance and gradient tensor of all blocks
+ * integral image of pixel tensor is kept in image for stages working with other block sizes
+ * has to run again whenever processed image is replaced
+ */
+void BlockFeatureExtractor::extract(Image* image)
+{
+	accumulate(image);
+}
+
+
+//mean and variance only, used when background is estimated without the rest of pipeline
+void BlockFeatureExtractor::extractIntensityStatistics(Image* image)
+{
+	BlockStatistics statistics;
+	accumulateBlockIntensity(image, &statistics);
+	image->setBlockStatistics(std::move(statistics));
+}
+
+
+/**
+ * block sums are accumulated row by row, memory is block sized
+ */
+void BlockFeatureExtractor::accumulateBlockIntensity(Image* image, BlockStatistics* statistics)
+{
+	const cv::Mat& img = image->getProcessedImage();
+	int blockSize = image->getBlockSize();
+	int blocksX = img.cols / blockSize;
+	int blocksY = img.rows / blockSize;
+	double pixelsInBlock = blockSize * blockSize;
+
+	statistics->mean = BlockGrid<double>(blocksX, blocksY, 0.);
+	statistics->variance = BlockGrid<double>(blocksX, blocksY, 0.);
+
+	//sums of intensity and its squares, converted to mean and variance in place
+	for (int pixelY = 0; pixelY < blocksY * blockSize; pixelY++)
+	{
+		const unsigned char* pixelRow = img.ptr<unsigned char>(pixelY);
+		double* sumRow = statistics->mean.row(pixelY / blockSize);
+		double* squareSumRow = statistics->variance.row(pixelY / blockSize);
+
+		for (int pixelX = 0; pixelX < blocksX * blockSize; pixelX++)
+		{
+			double value = pixelRow[pixelX];
+			sumRow[pixelX / blockSize] += value;
+			squareSumRow[pixelX / blockSize] += value * value;
+		}
+	}
+
+	for (int i = 0; i < statistics->mean.count(); i++)
+	{
+		double mean = statistics->mean.data()[i] / pixelsInBlock;
+		double variance = statistics->variance.data()[i] / pixelsInBlock - mean * mean;
+
+		statistics->mean.data()[i] = mean;
+		statistics->variance.data()[i] = (variance > 0.) ? variance : 0.;
+	}
+}
+
+
+void BlockFeatureExtractor::accumulate(Image* image)
+{
+	const cv::Mat& img = image->getProcessedImage();
+	int blockSize = image->getBlockSize();
+	int blocksX = img.cols / blockSize;
+	int blocksY = img.rows / blockSize;
+	double pixelsInBlock = blockSize * blockSize;
+
+	BlockStatistics statistics;
+	accumulateBlockIntensity(image, &statistics);
+
+	//gradients are needed only while tensor integral is built
+	cv::Mat gradX = image->acquireBuffer(GRADIENT_X, img.size(), CV_PIXEL);
+	cv::Mat gradY = image->acquireBuffer(GRADIENT_Y, img.size(), CV_PIXEL);
+	OrientationsEstimator::calcGradX(img, gradX, CV_PIXEL);
+	OrientationsEstimator::calcGradY(img, gradY, CV_PIXEL);
+
+	GradientField gradients;
+	gradients.tensorIntegral = image->acquireBuffer(TENSOR_INTEGRAL, img.size() + cv::Size(1, 1), CV_64FC3);
+	gradients.tensorIntegral.row(0).setTo(cv::Scalar::all(0));
+
+	statistics.gxx = BlockGrid<double>(blocksX, blocksY, 0.);
+	statistics.gyy = BlockGrid<double>(blocksX, blocksY, 0.);
+	statistics.gxy = BlockGrid<double>(blocksX, blocksY, 0.);
+
+	//integral row is previous integral row plus running sum of current pixel row
+	for (int pixelY = 0; pixelY < img.rows; pixelY++)
+	{
+		const pixel_t* gradXRow = gradX.ptr<pixel_t>(pixelY);
+		const pixel_t* gradYRow = gradY.ptr<pixel_t>(pixelY);
+		const cv::Vec3d* tensorAbove = gradients.tensorIntegral.ptr<cv::Vec3d>(pixelY);
+		cv::Vec3d* tensorRow = gradients.tensorIntegral.ptr<cv::Vec3d>(pixelY + 1);
+		cv::Vec3d tensorSum(0., 0., 0.);
+		tensorRow[0] = tensorSum;
+
+		for (int pixelX = 0; pixelX < img.cols; pixelX++)
+		{
+			double pixelGradX = gradXRow[pixelX];
+			double pixelGradY = gradYRow[pixelX];
+			tensorSum += cv::Vec3d(pixelGradX * pixelGradX, pixelGradY * pixelGradY, pixelGradX * pixelGradY);
+			tensorRow[pixelX + 1] = tensorAbove[pixelX + 1] + tensorSum;
+		}
+	}
+
+	//block tensors are lookups into integral image
+	for (int blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksX; blockX++)
+		{
+			cv::Rect block(blockX * blockSize, blockY * blockSize, blockSize, blockSize);
+
+			cv::Vec3d tensor = getTensorSum(gradients.tensorIntegral, block);
+			statistics.gxx(blockX, blockY) = tensor[0] / pixelsInBlock;
+			statistics.gyy(blockX, blockY) = tensor[1] / pixelsInBlock;
+			statistics.gxy(blockX, blockY) = tensor[2] / pixelsInBlock;
+		}
+	}
+
+	image->setBlockStatistics(std::move(statistics));
+	image->setGradientField(gradients);
+}
+
+
+/**
+ * sums of gxx, gyy and gxy in any rectangle of pixels with four lookups
+ * rectangle is clipped to the image
+ */
+cv::Vec3d BlockFeatureExtractor::getTensorSum(const cv::Mat& tensorIntegral, const cv::Rect& rect)
+{
+	cv::Rect clipped = rect & cv::Rect(0, 0, tensorIntegral.cols - 1, tensorIntegral.rows - 1);
+	if (clipped.empty())
+		return cv::Vec3d(0., 0., 0.);
+
+	const cv::Vec3d* topRow = tensorIntegral.ptr<cv::Vec3d>(clipped.y);
+	const cv::Vec3d* bottomRow = tensorIntegral.ptr<cv::Vec3d>(clipped.y + clipped.height);
+
+	return bottomRow[clipped.x + clipped.width] - bottomRow[clipped.x] - topRow[clipped.x + clipped.width] + topRow[clipped.x];
+}
+
+
+//integral at any pixel corner, tensor is taken as constant inside of every block
+static cv::Vec3d interpolateIntegral(const cv::Mat& tensorIntegral, int step, int x, int y)
+{
+	int cellX = std::min(x / step, tensorIntegral.cols - 2);
+	int cellY = std::min(y / step, tensorIntegral.rows - 2);
+	double weightX = static_cast<double>(x - cellX * step) / step;
+	double weightY = static_cast<double>(y - cellY * step) / step;
+
+	const cv::Vec3d* topRow = tensorIntegral.ptr<cv::Vec3d>(cellY);
+	const cv::Vec3d* bottomRow = tensorIntegral.ptr<cv::Vec3d>(cellY + 1);
+	cv::Vec3d top = topRow[cellX] * (1. - weightX) + topRow[cellX + 1] * weightX;
+	cv::Vec3d bottom = bottomRow[cellX] * (1. - weightX) + bottomRow[cellX + 1] * weightX;
+
+	return top * (1. - weightY) + bottom * weightY;
+}
+
+
+/**
+ * same as lookup into pixel integral, block integral of tiled image is interpolated,
+ * which is exact for rectangles aligned to blocks
+ */
+cv::Vec3d BlockFeatureExtractor::getTensorSum(const GradientField& gradients, const cv::Rect& rect)
+{
+	if (gradients.step == 1)
+		return getTensorSum(gradients.tensorIntegral, rect);
+
+	cv::Rect clipped = rect & cv::Rect(0, 0, (gradients.tensorIntegral.cols - 1) * gradients.step, (gradients.tensorIntegral.rows - 1) * gradients.step);
+	if (clipped.empty())
+		return cv::Vec3d(0., 0., 0.);
+
+	return interpolateIntegral(gradients.tensorIntegral, gradients.step, clipped.x + clipped.width, clipped.y + clipped.height)
+		- interpolateIntegral(gradients.tensorIntegral, gradients.step, clipped.x, clipped.y + clipped.height)
+		- interpolateIntegral(gradients.tensorIntegral, gradients.step, clipped.x + clipped.width, clipped.y)
+		+ interpolateIntegral(gradients.tensorIntegral, gradients.step, clipped.x, clipped.y);
+}
+
+
+/**
+ * integral of block tensors with one sample per block corner, used when pixel integral of whole image
+ * is not kept because features were extracted tile by tile
+ */
+GradientField BlockFeatureExtractor::getBlockTensorIntegral(const BlockStatistics& statistics, int blockSize)
+{
+	int blocksX = statistics.gxx.getWidth();
+	int blocksY = statistics.gxx.getHeight();
+	double pixelsInBlock = blockSize * blockSize;
+
+	GradientField gradients;
+	gradients.step = blockSize;
+	gradients.tensorIntegral = cv::Mat(blocksY + 1, blocksX + 1, CV_64FC3, cv::Scalar::all(0));
+
+	for (int blockY = 0; blockY < blocksY; blockY++)
+	{
+		const cv::Vec3d* integralAbove = gradients.tensorIntegral.ptr<cv::Vec3d>(blockY);
+		cv::Vec3d* integralRow = gradients.tensorIntegral.ptr<cv::Vec3d>(blockY + 1);
+		cv::Vec3d rowSum(0., 0., 0.);
+
+		for (int blockX = 0; blockX < blocksX; blockX++)
+		{
+			rowSum += cv::Vec3d(statistics.gxx(blockX, blockY), statistics.gyy(blockX, blockY), statistics.gxy(blockX, blockY)) * pixelsInBlock;
+			integralRow[blockX + 1] = integralAbove[blockX + 1] + rowSum;
+		}
+	}
+
+	return gradients;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Image.h"
+#include "BlockStatistics.h"
+
+class BlockFeatureExtractor
+{
+private:
+	void accumulate(Image* image);
+	void accumulateBlockIntensity(Image* image, BlockStatistics* statistics);
+
+public:
+	BlockFeatureExtractor();
+	void extract(Image* image);
+	void extractIntensityStatistics(Image* image);
+
+	static cv::Vec3d getTensorSum(const cv::Mat& tensorIntegral, const cv::Rect& rect);
+	static cv::Vec3d getTensorSum(const GradientField& gradients, const cv::Rect& rect);
+	static GradientField getBlockTensorIntegral(const BlockStatistics& statistics, int blockSize);
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <algorithm>
+
+/**
+ * typed per-block field with continuous row-major storage
+ * shares data with the cv::Mat it is created from, so fields stored in Image stay cv::Mat
+ */
+template<typename T>
+class BlockGrid
+{
+private:
+	cv::Mat mat;
+	T* values;
+	int width;
+	int height;
+
+public:
+	BlockGrid()
+	{
+		this->values = nullptr;
+		this->width = 0;
+		this->height = 0;
+	}
+
+	BlockGrid(int width, int height)
+		: BlockGrid(cv::Mat(height, width, cv::DataType<T>::type))
+	{
+	}
+
+	BlockGrid(int width, int height, T value)
+		: BlockGrid(cv::Mat(height, width, cv::DataType<T>::type))
+	{
+		fill(value);
+	}
+
+	explicit BlockGrid(const cv::Mat& mat)
+	{
+		CV_Assert(mat.type() == cv::DataType<T>::type && mat.isContinuous());
+
+		this->mat = mat;
+		this->values = reinterpret_cast<T*>(this->mat.data);
+		this->width = mat.cols;
+		this->height = mat.rows;
+	}
+
+	T& operator()(int x, int y)
+	{
+		return this->values[y * this->width + x];
+	}
+
+	const T& operator()(int x, int y) const
+	{
+		return this->values[y * this->width + x];
+	}
+
+	T& operator()(const cv::Point& block)
+	{
+		return this->values[block.y * this->width + block.x];
+	}
+
+	const T& operator()(const cv::Point& block) const
+	{
+		return this->values[block.y * this->width + block.x];
+	}
+
+	T* row(int y)
+	{
+		return this->values + y * this->width;
+	}
+
+	const T* row(int y) const
+	{
+		return this->values + y * this->width;
+	}
+
+	T* data()
+	{
+		return this->values;
+	}
+
+	const T* data() const
+	{
+		return this->values;
+	}
+
+	int getWidth() const
+	{
+		return this->width;
+	}
+
+	int getHeight() const
+	{
+		return this->height;
+	}
+
+	int count() const
+	{
+		return this->width * this->height;
+	}
+
+	bool empty() const
+	{
+		return this->values == nullptr;
+	}
+
+	bool isInRange(int x, int y) const
+	{
+		return x >= 0 && x < this->width && y >= 0 && y < this->height;
+	}
+
+	bool isBorder(int x, int y) const
+	{
+		return x == 0 || y == 0 || x == this->width - 1 || y == this->height - 1;
+	}
+
+	//border-safe read, outside of the grid returns given value
+	T getOrDefault(int x, int y, T defaultValue) const
+	{
+		return isInRange(x, y) ? (*this)(x, y) : defaultValue;
+	}
+
+	//number of blocks with given value in 3x3 neighborhood including the block itself
+	int countInNeighborhood(int x, int y, T value) const
+	{
+		int count = 0;
+		int fromY = (y > 0) ? y - 1 : 0;
+		int toY = (y < this->height - 1) ? y + 1 : this->height - 1;
+		int fromX = (x > 0) ? x - 1 : 0;
+		int toX = (x < this->width - 1) ? x + 1 : this->width - 1;
+
+		for (int neighY = fromY; neighY <= toY; neighY++)
+		{
+			const T* neighRow = row(neighY);
+			for (int neighX = fromX; neighX <= toX; neighX++)
+			{
+				if (neighRow[neighX] == value)
+					count++;
+			}
+		}
+
+		return count;
+	}
+
+	void fill(T value)
+	{
+		std::fill(this->values, this->values + count(), value);
+	}
+
+	BlockGrid<T> clone() const
+	{
+		return BlockGrid<T>(this->mat.clone());
+	}
+
+	cv::Mat getMat() const
+	{
+		return this->mat;
+	}
+};
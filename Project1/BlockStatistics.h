@@ -0,0 +1,13 @@
+#pragma once
+#include "BlockGrid.h"
+
+//per-block statistics of processed image, one grid per feature
+typedef struct BlockStatistics {
+	BlockGrid<double> mean;
+	BlockGrid<double> variance;
+
+	//mean gradient tensor components, empty when only intensity was extracted
+	BlockGrid<double> gxx;
+	BlockGrid<double> gyy;
+	BlockGrid<double> gxy;
+}BlockStatistics;
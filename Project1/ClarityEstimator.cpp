@@ -7,49 +7,36 @@ ClarityEstimator::ClarityEstimator() {
 
 cv::Mat ClarityEstimator::computeClarity(Image* image)
 {
-	cv::Mat img = image->getProcessedImage();
+	const BlockStatistics& statistics = image->getBlockStatistics();
 	cv::Mat backgroundMask = image->getBackgroundMask();
-	int blockSize = image->getBlockSize();
 
-	cv::Mat clarityMap = cv::Mat::zeros(img.rows / blockSize, img.cols / blockSize, CV_8U);
-
-	for (int blockX = 0; blockX < clarityMap.cols; blockX++) {
-		for (int blockY = 0; blockY < clarityMap.rows; blockY++) {
-			//skip background areas
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
-				clarityMap.at<unsigned char>(blockY, blockX) = BACKGROUND;
-				continue;
-			}
-
-			//calculate mean and variance in block
-			cv::Scalar meanSc, devSc;
-			double mean, stdDev, variance;
-
-			//subduct only the current block
-			cv::Mat block = img(cv::Rect(blockX * blockSize, blockY * blockSize, blockSize, blockSize));
-			meanStdDev(block, meanSc, devSc);
-			mean = meanSc.val[0];
-			stdDev = devSc.val[0];
-			variance = pow(stdDev, 2);
-
-            //low quality areas will have lower mean value of gray intensity
-            if(mean < 100)
-            {
-				clarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
-            }
-			else
-			{
-				clarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
-			}
-
-			//low quality areas will have lower variance value of gray intensity
-			if (variance < 200) {
-				clarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
-			}
-			else {
-				clarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
-			}
+	//background areas are skipped
+	cv::Mat clarityMap(statistics.mean.getHeight(), statistics.mean.getWidth(), CV_8U, cv::Scalar(BACKGROUND));
+
+	for (const cv::Point& foregroundBlock : image->getForegroundBlocks().getBlocks()) {
+		int blockX = foregroundBlock.x;
+		int blockY = foregroundBlock.y;
+
+		//mean and variance in block are extracted together with other block features
+		double mean = statistics.mean(foregroundBlock);
+		double variance = statistics.variance(foregroundBlock);
+
+        //low quality areas will have lower mean value of gray intensity
+        if(mean < 100)
+        {
+			clarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
+        }
+		else
+		{
+			clarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
+		}
 
+		//low quality areas will have lower variance value of gray intensity
+		if (variance < 200) {
+			clarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
+		}
+		else {
+			clarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
 		}
 	}
 
@@ -26,54 +26,50 @@ bool DamageDetector::setup(Image* image)
 
 void DamageDetector::detectDamagedAreas()
 {
-	auto orientationsDiscontinuityDetector = new OrientationDiscontinuityDetector();
-	cv::Mat odMap = orientationsDiscontinuityDetector->detectDiscontinuities(this->image);
+	auto orientationsDiscontinuityDetector = OrientationDiscontinuityDetector();
+	cv::Mat odMap = orientationsDiscontinuityDetector.detectDiscontinuities(this->image);
 
-	auto oclEstimator = new OCLEstimator();
-	cv::Mat oclMap = oclEstimator->computeOcl(this->image);
+	auto oclEstimator = OCLEstimator();
+	cv::Mat oclMap = oclEstimator.computeOcl(this->image);
 
-	auto ridgeClarityEstimator = new RidgeClarityEstimator();
-	cv::Mat ridgeClarityMap = ridgeClarityEstimator->computeRidgeClarity(this->image);
+	auto ridgeClarityEstimator = RidgeClarityEstimator();
+	cv::Mat ridgeClarityMap = ridgeClarityEstimator.computeRidgeClarity(this->image);
 
-	auto clarityEstimator = new ClarityEstimator();
-	cv::Mat clarityMap = clarityEstimator->computeClarity(this->image);
+	auto clarityEstimator = ClarityEstimator();
+	cv::Mat clarityMap = clarityEstimator.computeClarity(this->image);
 
-	cv::Mat qualityMap = getRidgeQualityMap(odMap, oclMap, ridgeClarityMap, clarityMap, this->image->getBackgroundMask());
+	cv::Mat qualityMap = getRidgeQualityMap(odMap, oclMap, ridgeClarityMap, clarityMap, this->image->getForegroundBlocks());
 	cv::Mat qualityMapShow;
 
 	this->image->setQualityMap(qualityMap);
 
-	auto highDamageDetector = new HighDamageDetector();
-	highDamageDetector->findHeavilyDamagedAreas(this->image);
+	auto highDamageDetector = HighDamageDetector();
+	highDamageDetector.findHeavilyDamagedAreas(this->image);
 }
 
 
 cv::Mat DamageDetector::getRidgeQualityMap(cv::Mat odMap, cv::Mat oclMap, cv::Mat ridgeClarityMap, cv::Mat clarityMap,
-    cv::Mat backgroundMask)
+    const ForegroundBlockIndex& foregroundBlocks)
 {
-	cv::Mat qualityMap = cv::Mat::zeros(backgroundMask.size(), CV_64F);
-
-    for(int blockX = 0; blockX < backgroundMask.cols; blockX++)
+	//background areas are skipped
+	BlockGrid<double> qualityMap(odMap.cols, odMap.rows, BACKGROUND);
+	BlockGrid<unsigned char> discontinuities(odMap);
+	BlockGrid<unsigned char> ocl(oclMap);
+	BlockGrid<unsigned char> clarity(clarityMap);
+	BlockGrid<unsigned char> ridgeClarity(ridgeClarityMap);
+
+    for(const cv::Point& block : foregroundBlocks.getBlocks())
     {
-        for(int blockY = 0; blockY < backgroundMask.rows; blockY++)
-        {
-            if(BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
-            {
-				qualityMap.at<double>(blockY, blockX) = BACKGROUND;
-                continue;
-            }
-
-			double odScore = getOrientationDiscontinuityScore(static_cast<double>(odMap.at<unsigned char>(blockY, blockX)));
-			double oclScore = getOCLScore(static_cast<double>(oclMap.at<unsigned char>(blockY, blockX)));
-			double clarityScore = getClarityScore(static_cast<double>(clarityMap.at<unsigned char>(blockY, blockX)));
-			double ridgeClarityScore = getRidgeClarityScore(static_cast<double>(ridgeClarityMap.at<unsigned char>(blockY, blockX)));
-
-			double qualityEstimation = estimateOverallQualityFromFeatures(odScore, oclScore, clarityScore, ridgeClarityScore);
-			qualityMap.at<double>(blockY, blockX) = qualityEstimation;
-        }
+		double odScore = getOrientationDiscontinuityScore(static_cast<double>(discontinuities(block)));
+		double oclScore = getOCLScore(static_cast<double>(ocl(block)));
+		double clarityScore = getClarityScore(static_cast<double>(clarity(block)));
+		double ridgeClarityScore = getRidgeClarityScore(static_cast<double>(ridgeClarity(block)));
+
+		double qualityEstimation = estimateOverallQualityFromFeatures(odScore, oclScore, clarityScore, ridgeClarityScore);
+		qualityMap(block) = qualityEstimation;
     }
 
-	return qualityMap;
+	return qualityMap.getMat();
 }
 
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Image.h"
+#include "BlockGrid.h"
 #include "BackgroundSubstractor.h"
 #include "OrientationDiscontinuityDetector.h"
 #include "OCLEstimator.h"
@@ -17,7 +18,8 @@ public:
 	bool setup(Image* image);
     bool lowDamageBlockWasNotChangedYet(cv::Mat former, cv::Mat updated, int x, int y);
 	void detectDamagedAreas();
-    cv::Mat getRidgeQualityMap(cv::Mat odMap, cv::Mat oclMap, cv::Mat ridgeClarityMap, cv::Mat clarityMap, cv::Mat backgroundMask);
+    cv::Mat getRidgeQualityMap(cv::Mat odMap, cv::Mat oclMap, cv::Mat ridgeClarityMap, cv::Mat clarityMap,
+        const ForegroundBlockIndex& foregroundBlocks);
 
 	double getOrientationDiscontinuityScore(double value);
 	double getOCLScore(double value);
@@ -0,0 +1,195 @@
+#include "FieldBundle.h"
+#include "BlockGrid.h"
+#include <fstream>
+#include <climits>
+
+
+FieldBundle::FieldBundle()
+{
+}
+
+
+//labels of highly damaged areas in block grid, 0 for blocks outside of them
+cv::Mat FieldBundle::getDamagedAreaLabels(Image* image)
+{
+	const cv::Mat& backgroundMask = image->getBackgroundMask();
+	BlockGrid<int> labels(backgroundMask.cols, backgroundMask.rows, 0);
+
+	for (const ImageArea& area : image->getHighlyDamagedAreas())
+	{
+		for (const cv::Point& point : area.getPoints())
+		{
+			labels(point) = area.getLabel();
+		}
+	}
+
+	return labels.getMat();
+}
+
+
+/**
+ * appends one record, whole file is replaced when append is false
+ * fields that were not computed are stored as empty sections
+ */
+bool FieldBundle::write(const std::string& path, Image* image, int sourceIndex, bool append)
+{
+	std::ofstream output(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+	if (!output)
+		return false;
+
+	cv::Mat sections[FIELD_BUNDLE_SECTIONS];
+	sections[ORIENTATION_SECTION] = image->getOrientationField();
+	sections[FREQUENCY_SECTION] = image->getFrequencyField();
+	sections[QUALITY_SECTION] = image->getQualityMap();
+	sections[BACKGROUND_SECTION] = image->getBackgroundMask();
+	sections[SINGULARITY_SECTION] = image->getSingularityMap();
+	sections[DAMAGED_AREA_LABELS_SECTION] = getDamagedAreaLabels(image);
+	sections[PROCESSED_IMAGE_SECTION] = image->getProcessedImage();
+
+	FieldBundleSectionEntry entries[FIELD_BUNDLE_SECTIONS];
+	uint64_t offset = sizeof(FieldBundleHeader) + sizeof(entries);
+
+	for (int i = 0; i < FIELD_BUNDLE_SECTIONS; i++)
+	{
+		offset = (offset + FIELD_BUNDLE_ALIGNMENT - 1) / FIELD_BUNDLE_ALIGNMENT * FIELD_BUNDLE_ALIGNMENT;
+
+		entries[i].section = static_cast<uint32_t>(i);
+		entries[i].type = static_cast<uint32_t>(sections[i].type());
+		entries[i].rows = static_cast<uint32_t>(sections[i].rows);
+		entries[i].cols = static_cast<uint32_t>(sections[i].cols);
+		entries[i].offset = offset;
+		entries[i].bytes = static_cast<uint64_t>(sections[i].total()) * sections[i].elemSize();
+
+		offset += entries[i].bytes;
+	}
+
+	cv::Size size = image->getSize();
+	FieldBundleHeader header = {
+		FIELD_BUNDLE_MAGIC, FIELD_BUNDLE_VERSION, FIELD_BUNDLE_SECTIONS, static_cast<uint32_t>(image->getBlockSize()),
+		static_cast<uint32_t>(size.width), static_cast<uint32_t>(size.height), static_cast<uint32_t>(sourceIndex), 0,
+		(offset + FIELD_BUNDLE_ALIGNMENT - 1) / FIELD_BUNDLE_ALIGNMENT * FIELD_BUNDLE_ALIGNMENT
+	};
+
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+
+	const char padding[FIELD_BUNDLE_ALIGNMENT] = { 0 };
+	uint64_t written = sizeof(FieldBundleHeader) + sizeof(entries);
+
+	for (int i = 0; i < FIELD_BUNDLE_SECTIONS; i++)
+	{
+		output.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+
+		//rows are written one by one, ROI is not continuous
+		size_t rowBytes = sections[i].cols * sections[i].elemSize();
+		for (int row = 0; row < sections[i].rows; row++)
+		{
+			output.write(reinterpret_cast<const char*>(sections[i].ptr(row)), static_cast<std::streamsize>(rowBytes));
+		}
+
+		written = entries[i].offset + entries[i].bytes;
+	}
+
+	//next record starts aligned too
+	output.write(padding, static_cast<std::streamsize>(header.recordSize - written));
+
+	return static_cast<bool>(output);
+}
+
+
+bool FieldBundle::open(const std::string& path)
+{
+	this->records.clear();
+
+	if (!this->file.open(path))
+		return false;
+
+	this->file.adviseSequential();
+
+	//records are found by walking their sizes, nothing else is read
+	uint64_t position = 0;
+	while (position + sizeof(FieldBundleHeader) <= this->file.getSize())
+	{
+		const FieldBundleHeader* header = reinterpret_cast<const FieldBundleHeader*>(this->file.getData() + position);
+
+		if (header->magic != FIELD_BUNDLE_MAGIC || header->version != FIELD_BUNDLE_VERSION ||
+			header->recordSize < sizeof(FieldBundleHeader) || header->recordSize > this->file.getSize() - position)
+		{
+			this->records.clear();
+			return false;
+		}
+
+		const FieldBundleSectionEntry* entries = reinterpret_cast<const FieldBundleSectionEntry*>(header + 1);
+		bool valid = header->sectionCount <= (header->recordSize - sizeof(FieldBundleHeader)) / sizeof(FieldBundleSectionEntry);
+
+		for (uint32_t i = 0; valid && i < header->sectionCount; i++)
+		{
+			valid = isValidSection(entries[i], header->recordSize);
+		}
+
+		if (!valid)
+		{
+			this->records.clear();
+			return false;
+		}
+
+		this->records.push_back(header);
+		position += header->recordSize;
+	}
+
+	return true;
+}
+
+
+/**
+ * section has to be inside of its record and hold exactly rows x cols elements of valid type,
+ * so matrix returned by getField never reads outside of the mapping
+ */
+bool FieldBundle::isValidSection(const FieldBundleSectionEntry& entry, uint64_t recordSize)
+{
+	if (entry.offset > recordSize || entry.bytes > recordSize - entry.offset)
+		return false;
+
+	if (entry.type > CV_MAT_TYPE_MASK || entry.rows > INT_MAX || entry.cols > INT_MAX)
+		return false;
+
+	//element count is below 2^62, bytes are divided instead of multiplying it by element size
+	uint64_t elements = static_cast<uint64_t>(entry.rows) * entry.cols;
+	uint64_t elementSize = CV_ELEM_SIZE(entry.type);
+	return entry.bytes % elementSize == 0 && entry.bytes / elementSize == elements;
+}
+
+
+int FieldBundle::getRecordCount() const
+{
+	return static_cast<int>(this->records.size());
+}
+
+
+const FieldBundleHeader& FieldBundle::getHeader(int record) const
+{
+	return *this->records.at(record);
+}
+
+
+/**
+ * matrix over mapped data, valid while the bundle is open
+ * empty matrix if the section is missing or was empty when written
+ */
+cv::Mat FieldBundle::getField(int record, FieldBundleSection section) const
+{
+	const FieldBundleHeader* header = this->records.at(record);
+	const FieldBundleSectionEntry* entries = reinterpret_cast<const FieldBundleSectionEntry*>(header + 1);
+
+	for (uint32_t i = 0; i < header->sectionCount; i++)
+	{
+		if (entries[i].section != static_cast<uint32_t>(section) || entries[i].bytes == 0)
+			continue;
+
+		//mapping is read-only, matrix must not be written
+		void* data = const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(header) + entries[i].offset);
+		return cv::Mat(static_cast<int>(entries[i].rows), static_cast<int>(entries[i].cols), static_cast<int>(entries[i].type), data);
+	}
+
+	return cv::Mat();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Image.h"
+#include "MappedFile.h"
+
+#define FIELD_BUNDLE_MAGIC 0x42465046u
+#define FIELD_BUNDLE_VERSION 2
+//every section starts at multiple of this from the start of its record
+#define FIELD_BUNDLE_ALIGNMENT 64
+
+enum FieldBundleSection
+{
+	ORIENTATION_SECTION,
+	FREQUENCY_SECTION,
+	QUALITY_SECTION,
+	BACKGROUND_SECTION,
+	SINGULARITY_SECTION,
+	DAMAGED_AREA_LABELS_SECTION,
+	PROCESSED_IMAGE_SECTION,
+	FIELD_BUNDLE_SECTIONS
+};
+
+//fixed header at start of each record, record of one image is followed by record of the next one
+//records are not in input order and failed images have none, source index identifies the input image
+typedef struct FieldBundleHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sectionCount;
+	uint32_t blockSize;
+	uint32_t imageWidth;
+	uint32_t imageHeight;
+	uint32_t sourceIndex;
+	uint32_t reserved;
+	uint64_t recordSize;
+}FieldBundleHeader;
+
+//section is stored as continuous matrix of given OpenCV type, offset is relative to record start
+typedef struct FieldBundleSectionEntry {
+	uint32_t section;
+	uint32_t type;
+	uint32_t rows;
+	uint32_t cols;
+	uint64_t offset;
+	uint64_t bytes;
+}FieldBundleSectionEntry;
+
+/**
+ * block fields and result of processed images in one file
+ * reader maps the file and returns matrices over mapped data without parsing or copying
+ */
+class FieldBundle
+{
+private:
+	MappedFile file;
+	std::vector<const FieldBundleHeader*> records;
+
+	static cv::Mat getDamagedAreaLabels(Image* image);
+	static bool isValidSection(const FieldBundleSectionEntry& entry, uint64_t recordSize);
+
+public:
+	FieldBundle();
+	bool open(const std::string& path);
+	int getRecordCount() const;
+	const FieldBundleHeader& getHeader(int record) const;
+	cv::Mat getField(int record, FieldBundleSection section) const;
+
+	static bool write(const std::string& path, Image* image, int sourceIndex, bool append);
+};
@@ -0,0 +1,91 @@
+#include "FieldQuantizer.h"
+#include "BlockGrid.h"
+#include <cmath>
+
+
+const FieldQuantizer::Tables FieldQuantizer::tables;
+
+
+FieldQuantizer::Tables::Tables()
+{
+	for (int bin = 0; bin < ORIENTATION_BINS; bin++)
+	{
+		double radians = orientationToDegrees(static_cast<unsigned char>(bin)) * CV_PI / 180.;
+		this->cosines[bin] = cos(radians);
+		this->sines[bin] = sin(radians);
+	}
+
+	//bin 1 is PERIOD_MIN, last bin is PERIOD_MAX
+	this->frequencies[NO_PERIOD] = 0.;
+	for (int period = 1; period < PERIOD_BINS; period++)
+	{
+		this->frequencies[period] = 1. / (PERIOD_MIN * pow(PERIOD_MAX / PERIOD_MIN, (period - 1.) / (PERIOD_BINS - 2)));
+	}
+}
+
+
+unsigned char FieldQuantizer::quantizeOrientation(double degrees)
+{
+	double axial = fmod(degrees, 180.);
+	if (axial < 0) axial += 180.;
+
+	//180 degrees wraps to bin 0
+	int bin = cvRound(axial * ORIENTATION_BINS / 180.);
+	return static_cast<unsigned char>(bin % ORIENTATION_BINS);
+}
+
+
+double FieldQuantizer::orientationToDegrees(unsigned char bin)
+{
+	return bin * 180. / ORIENTATION_BINS;
+}
+
+
+//unknown or background frequency is NO_PERIOD
+unsigned char FieldQuantizer::quantizePeriod(double frequency)
+{
+	if (frequency <= 0)
+		return NO_PERIOD;
+
+	//relative step is the same for all periods, so resolution does not depend on image resolution
+	double position = log(1. / (frequency * PERIOD_MIN)) / log(PERIOD_MAX / PERIOD_MIN);
+	int period = 1 + cvRound(position * (PERIOD_BINS - 2));
+	if (period < 1) period = 1;
+	if (period > PERIOD_BINS - 1) period = PERIOD_BINS - 1;
+
+	return static_cast<unsigned char>(period);
+}
+
+
+double FieldQuantizer::periodToFrequency(unsigned char period)
+{
+	return tables.frequencies[period];
+}
+
+
+cv::Mat FieldQuantizer::quantizeOrientationField(const cv::Mat& orientationField)
+{
+	BlockGrid<double> orientations(orientationField);
+	BlockGrid<unsigned char> bins(orientations.getWidth(), orientations.getHeight());
+
+	for (int i = 0; i < orientations.count(); i++)
+	{
+		bins.data()[i] = quantizeOrientation(orientations.data()[i]);
+	}
+
+	return bins.getMat();
+}
+
+
+cv::Mat FieldQuantizer::quantizePeriodField(const cv::Mat& frequencyField)
+{
+	BlockGrid<double> frequencies(frequencyField);
+	BlockGrid<unsigned char> periods(frequencies.getWidth(), frequencies.getHeight());
+
+	for (int i = 0; i < frequencies.count(); i++)
+	{
+		periods.data()[i] = quantizePeriod(frequencies.data()[i]);
+	}
+
+	return periods.getMat();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+
+//orientation 0 - 180 degrees in uint8 bins
+#define ORIENTATION_BINS 256
+
+//period on logarithmic scale from PERIOD_MIN to PERIOD_MAX pixels, uint8, about 1.4 % per bin
+//periods outside of the range are clamped to the first or last bin
+#define PERIOD_MIN 2.
+#define PERIOD_MAX 64.
+#define PERIOD_BINS 256
+#define NO_PERIOD 0
+
+/**
+ * compact orientation and frequency representation with shared sine and cosine tables
+ * orientation is axial, angles differing by 180 degrees share one bin
+ */
+class FieldQuantizer
+{
+private:
+	struct Tables
+	{
+		double cosines[ORIENTATION_BINS];
+		double sines[ORIENTATION_BINS];
+		double frequencies[PERIOD_BINS];
+		Tables();
+	};
+
+	static const Tables tables;
+
+public:
+	static unsigned char quantizeOrientation(double degrees);
+	static double orientationToDegrees(unsigned char bin);
+	static unsigned char quantizePeriod(double frequency);
+	static double periodToFrequency(unsigned char period);
+
+	static cv::Mat quantizeOrientationField(const cv::Mat& orientationField);
+	static cv::Mat quantizePeriodField(const cv::Mat& frequencyField);
+
+	static double cosine(unsigned char bin)
+	{
+		return tables.cosines[bin];
+	}
+
+	static double sine(unsigned char bin)
+	{
+		return tables.sines[bin];
+	}
+};
@@ -1,14 +1,16 @@
 #include "Filter.h"
+#include "GaussianKernelCache.h"
 
 
 Filter::Filter()
 {
+    this->srcImage = nullptr;
 }
 
 
 void Filter::setup(Image* image)
 {
-    this->srcImage = *image;
+    this->srcImage = image;
 }
 
 
@@ -24,9 +26,61 @@ void Filter::filter()
 }
 
 
+//shared cached kernel, must not be written
 cv::Mat Filter::get2DGaussianKernel(int rows, int cols, double sigmax, double sigmay)
 {
-    auto gauss_x = cv::getGaussianKernel(cols, sigmax, CV_64F);
-    auto gauss_y = cv::getGaussianKernel(rows, sigmay, CV_64F);
-    return gauss_x * gauss_y.t();
+    return GaussianKernelCache::get2D(rows, cols, sigmax, sigmay, CV_64F);
 }
+
+
+/**
+ * 1D kernel between blocks equal to extending blocks to pixels, convolving with gaussian of kernelSize
+ * and averaging back per block: w(d) = 1/bs * sum_i sum_j g(d*bs + j - i + anchor)
+ * pairs of pixel offsets (i, j) with the same difference m occur (bs - |m|) times
+ */
+cv::Mat Filter::getBlockGaussianKernel(int kernelSize, double sigma, int blockSize)
+{
+    cv::Mat gauss = GaussianKernelCache::get1D(kernelSize, sigma, CV_64F);
+    const double* g = gauss.ptr<double>(0);
+    int anchor = kernelSize / 2;
+
+    //block distances reachable by the pixel kernel, symmetric so that anchor is in the middle
+    int radius = (anchor + blockSize - 1) / blockSize;
+    cv::Mat blockKernel = cv::Mat::zeros(2 * radius + 1, 1, CV_64F);
+    double* w = blockKernel.ptr<double>(0);
+
+    for (int d = -radius; d <= radius; d++)
+    {
+        double weight = 0.;
+
+        for (int m = -(blockSize - 1); m <= blockSize - 1; m++)
+        {
+            int t = d * blockSize + m + anchor;
+            if (t >= 0 && t < kernelSize)
+                weight += (blockSize - abs(m)) * g[t];
+        }
+        w[d + radius] = weight / blockSize;
+    }
+
+    return blockKernel;
+}
+
+
+//smoothing of per-block field without going to full image resolution
+void Filter::smoothenBlockField(const cv::Mat& blockField, cv::Mat& smoothedField, int kernelSize, double sigma, int blockSize)
+{
+    cv::Mat blockKernel = GaussianKernelCache::getBlock(kernelSize, sigma, blockSize);
+    cv::sepFilter2D(blockField, smoothedField, CV_64F, blockKernel, blockKernel, cv::Point(-1, -1), 0, cv::BORDER_REFLECT_101);
+}
+
+
+/**
+ * same result as filter2D with get2DGaussianKernel
+ * separable convolution costs 2 * kernelSize per pixel instead of kernelSize^2
+ */
+void Filter::smoothenGaussian(const cv::Mat& src, cv::Mat& dst, int kernelSize, double sigma)
+{
+    cv::Mat gauss = GaussianKernelCache::get1D(kernelSize, sigma, CV_64F);
+    cv::sepFilter2D(src, dst, src.depth(), gauss, gauss, cv::Point(-1, -1), 0, cv::BORDER_REFLECT_101);
+}
+
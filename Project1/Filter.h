@@ -3,10 +3,14 @@
 #include <cstddef>
 #include "Image.h"
 
+//1 = smoothen orientation and frequency fields by full size convolution and block averaging
+#define FULL_RESOLUTION_SMOOTHING 0
+
 class Filter
 {
 protected:
-    Image srcImage;
+    //not owned, filter only reads features of the image
+    Image* srcImage;
     cv::Mat processedImage;
 
 public:
@@ -15,4 +19,7 @@ public:
     cv::Mat getResultImage();
     virtual void filter();
     static cv::Mat get2DGaussianKernel(int rows, int cols, double sigmax, double sigmay);
+    static cv::Mat getBlockGaussianKernel(int kernelSize, double sigma, int blockSize);
+    static void smoothenGaussian(const cv::Mat& src, cv::Mat& dst, int kernelSize, double sigma);
+    static void smoothenBlockField(const cv::Mat& blockField, cv::Mat& smoothedField, int kernelSize, double sigma, int blockSize);
 };
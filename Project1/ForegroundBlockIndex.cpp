@@ -0,0 +1,69 @@
+#include "ForegroundBlockIndex.h"
+#include "ImagePointState.h"
+
+
+ForegroundBlockIndex::ForegroundBlockIndex()
+{
+}
+
+
+ForegroundBlockIndex::ForegroundBlockIndex(const cv::Mat& backgroundMask)
+{
+	BlockGrid<unsigned char> background(backgroundMask);
+	this->bitmap = BlockGrid<unsigned char>(background.getWidth(), background.getHeight(), 0);
+	this->blocks.reserve(background.count());
+
+	for (int blockY = 0; blockY < background.getHeight(); blockY++)
+	{
+		const unsigned char* backgroundRow = background.row(blockY);
+		unsigned char* bitmapRow = this->bitmap.row(blockY);
+
+		for (int blockX = 0; blockX < background.getWidth(); blockX++)
+		{
+			if (backgroundRow[blockX] != BACKGROUND)
+			{
+				bitmapRow[blockX] = 1;
+				this->blocks.push_back(cv::Point(blockX, blockY));
+			}
+		}
+	}
+}
+
+
+const std::vector<cv::Point>& ForegroundBlockIndex::getBlocks() const
+{
+	return this->blocks;
+}
+
+
+bool ForegroundBlockIndex::isForeground(int blockX, int blockY) const
+{
+	return this->bitmap(blockX, blockY) != 0;
+}
+
+
+bool ForegroundBlockIndex::isForeground(const cv::Point& block) const
+{
+	return this->bitmap(block) != 0;
+}
+
+
+int ForegroundBlockIndex::count() const
+{
+	return static_cast<int>(this->blocks.size());
+}
+
+
+double ForegroundBlockIndex::getForegroundRatio() const
+{
+	if (this->bitmap.empty() || this->bitmap.count() == 0)
+		return 0.;
+
+	return static_cast<double>(this->blocks.size()) / this->bitmap.count();
+}
+
+
+bool ForegroundBlockIndex::empty() const
+{
+	return this->bitmap.empty();
+}
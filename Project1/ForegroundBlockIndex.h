@@ -0,0 +1,27 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+#include "BlockGrid.h"
+
+/**
+ * foreground blocks of one image, built once from background mask
+ * list is in row-major order, bitmap holds 1 for foreground blocks
+ */
+class ForegroundBlockIndex
+{
+private:
+	std::vector<cv::Point> blocks;
+	BlockGrid<unsigned char> bitmap;
+
+public:
+	ForegroundBlockIndex();
+	ForegroundBlockIndex(const cv::Mat& backgroundMask);
+
+	const std::vector<cv::Point>& getBlocks() const;
+	bool isForeground(int blockX, int blockY) const;
+	bool isForeground(const cv::Point& block) const;
+	int count() const;
+	double getForegroundRatio() const;
+	bool empty() const;
+};
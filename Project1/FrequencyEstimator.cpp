@@ -3,6 +3,9 @@
 #include <experimental/filesystem>
 #include "BackgroundSubstractor.h"
 #include "OrientationsEstimator.h"
+#include "FieldQuantizer.h"
+#include "OrientedWindowSampler.h"
+#include "GaussianKernelCache.h"
 
 
 FrequencyEstimator::FrequencyEstimator()
@@ -16,110 +19,74 @@ void FrequencyEstimator::computeFrequencyField(Image* image)
     int blockSize = image->getBlockSize();
     int windowWidth = image->getWindowWidth();
 
-    cv::Mat frequencyField(img.rows / blockSize, img.cols / blockSize, CV_64F);
+    //background blocks stay -1
+    BlockGrid<double> frequencyField(img.cols / blockSize, img.rows / blockSize, -1);
 
-    //iterate over blocks of frequency field (i,j)
-    for (int i = 0; i < frequencyField.cols; i++)
+    //x-signatures are sampled together with ridge clarity lines
+    if (image->getOrientedSignatures().intensity.empty())
     {
-        for (int j = 0; j < frequencyField.rows; j++)
-        {
-            if (BackgroundSubstractor::isBackgroundBlock(i, j, image->getBackgroundMask()))
-            {
-                frequencyField.at<double>(j, i) = -1;
-                continue;
-            }
+        OrientedWindowSampler(blockSize, windowWidth).sample(image);
+    }
+    const cv::Mat& signatures = image->getOrientedSignatures().intensity;
 
-            vector<double> xSignature(windowWidth, 0.0);
+    //signatures of all blocks are rows of one matrix, they are smoothed and searched for extremes at once
+    int kernelSize = ((blockSize / 9 * 7) >= 3) ? (blockSize / 9 * 7) : 3;
+    cv::Mat smoothedSignatures, maxMask, minMask;
+    smoothenSignatures(signatures, smoothedSignatures, kernelSize, 1);
+    findLocalExtremes(smoothedSignatures, maxMask, minMask);
 
-            int blockCenterPixelX = static_cast<int>(i * blockSize + (blockSize - 1) / 2);
-            int blockCenterPixelY = static_cast<int>(j * blockSize + (blockSize - 1) / 2);
+    //iterate over foreground blocks of frequency field (i,j)
+    for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
+    {
+        int i = block.x;
+        int j = block.y;
+        int row = j * frequencyField.getWidth() + i;
 
-            double orientationRad = image->getOrientationField().at<double>(j, i) * CV_PI / 180.0;
+        int periodInMaximums = estimatePeriod(maxMask.ptr<unsigned char>(row), maxMask.cols, windowWidth);
+        int periodInMinimums = estimatePeriod(minMask.ptr<unsigned char>(row), minMask.cols, windowWidth);
 
-            double cosine = cos(orientationRad);
-            double sine = sin(orientationRad);
+        bool frequencyInMinimums = periodInMinimums > 0;
+        bool frequencyInMaximums = periodInMaximums > 0;
 
-            //calculate all xSignature for current block (window)
-            for (int xSignIndex = 0; xSignIndex < windowWidth; xSignIndex++)
+        if (frequencyInMaximums || frequencyInMinimums)
+        {
+            //frequency found
+            int period;
+            if (frequencyInMaximums && frequencyInMinimums)
             {
-                //pixels withing the image area                
-                int validValuesOfIntensity = 0;
-
-                //iterate over pixels in one line according to the window field
-                for (int linePixelIndex = 0; linePixelIndex < blockSize; linePixelIndex++)
-                {
-                    //calculating coordinates of next pixel in line according to ridge line field 
-                    int linePixelX = static_cast<int>(
-                        blockCenterPixelX + (linePixelIndex - blockSize / 2) * cosine +
-                        (xSignIndex - windowWidth / 2) * sine);
-                    int linePixelY = static_cast<int>(
-                        blockCenterPixelY + (linePixelIndex - blockSize / 2) * sine +
-                        (windowWidth / 2 - xSignIndex) * cosine);
-
-                    //adding value to Sum of intensities of pixels in line
-                    if (Image::isElementInMatSizeRange(linePixelX, linePixelY, img))
-                    {
-                        //add only if pixel belongs to the processedImage area
-                        xSignature[xSignIndex] += (double)img.at<unsigned char>(linePixelY, linePixelX);
-                        validValuesOfIntensity++;
-                    }
-                }
-                //finishing calculation of one particular x-signature (average intensity)	
-                if (validValuesOfIntensity != 0)
-                {
-                    xSignature[xSignIndex] = xSignature[xSignIndex] / validValuesOfIntensity;
-                }
+                //freq in minimums and maximums --> average
+                period = (periodInMaximums + periodInMinimums) / 2;
             }
-			
-			int kernelSize = ((blockSize / 9 * 7) >= 3) ? (blockSize / 9 * 7) : 3;
-            xSignature = smoothenSignatures(xSignature, kernelSize, 1);
-
-            vector<int> locMaxIndexes = findLocalMax(xSignature);
-            vector<int> locMinIndexes = findLocalMin(xSignature);
-
-            bool frequencyInMinimums = frequencyFound(locMinIndexes, windowWidth);
-            bool frequencyInMaximums = frequencyFound(locMaxIndexes, windowWidth);
-
-            if (frequencyInMaximums || frequencyInMinimums)
+            else if (frequencyInMaximums)
             {
-                //frequency found
-                int period;
-                if (frequencyInMaximums && frequencyInMinimums)
-                {
-                    //freq in minimums and maximums --> average
-                    period = (getPeriodLenght(locMaxIndexes) + getPeriodLenght(locMinIndexes)) / 2;
-                }
-                else if (frequencyInMaximums)
-                {
-                    //freq in maximums only
-                    period = getPeriodLenght(locMaxIndexes);
-                }
-                else
-                {
-                    //freq in minimums only
-                    period = getPeriodLenght(locMinIndexes);
-                }
-
-                frequencyField.at<double>(j, i) = 1.0 / period;
+                //freq in maximums only
+                period = periodInMaximums;
             }
             else
             {
-                //not frequency could be estimated
-                frequencyField.at<double>(j, i) = -1;
+                //freq in minimums only
+                period = periodInMinimums;
             }
+
+            frequencyField(i, j) = 1.0 / period;
+        }
+        else
+        {
+            //not frequency could be estimated
+            frequencyField(i, j) = -1;
         }
     }
 
-    interpolateFreqField(img, frequencyField, blockSize, image->getBackgroundMask());
-    image->setFrequencyField(frequencyField);
+    interpolateFreqField(img, frequencyField.getMat(), blockSize, image->getForegroundBlocks());
+    image->setFrequencyField(frequencyField.getMat());
 }
 
 
 void FrequencyEstimator::interpolateFreqField(cv::Mat img, cv::Mat frequencyField, int blockSize,
-                                              cv::Mat backgroundMask)
+                                              const ForegroundBlockIndex& foregroundBlocks)
 {
-    cv::Mat enhancedFrequencyField;
-    frequencyField.copyTo(enhancedFrequencyField);
+    BlockGrid<double> frequencies(frequencyField);
+    BlockGrid<double> enhancedFrequencies = frequencies.clone();
 
     //size should be odd
     int kernelSize = static_cast<int>(blockSize * 1.5);
@@ -129,135 +96,112 @@ void FrequencyEstimator::interpolateFreqField(cv::Mat img, cv::Mat frequencyFiel
     cv::Mat gaussKernel = Filter::get2DGaussianKernel(kernelSize, kernelSize, 1, 1);
 
 
-    for (int blockX = 0; blockX < frequencyField.cols; blockX++)
+    //background is skipped
+    for (const cv::Point& block : foregroundBlocks.getBlocks())
     {
-        for (int blockY = 0; blockY < frequencyField.rows; blockY++)
-        {
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
-				//skip background
-			    continue;
-			}
+        int blockX = block.x;
+        int blockY = block.y;
 
-			//interpolate frequency value if could not be estimated for this block
-            if (frequencyField.at<double>(blockY, blockX) == -1)
-            {
-                int blockCenterX = static_cast<int>(blockX * blockSize + (blockSize - 1) / 2);
-                int blockCenterY = static_cast<int>(blockY * blockSize + (blockSize - 1) / 2);
+        //interpolate frequency value if could not be estimated for this block
+        if (frequencies(blockX, blockY) == -1)
+        {
+            int blockCenterX = static_cast<int>(blockX * blockSize + (blockSize - 1) / 2);
+            int blockCenterY = static_cast<int>(blockY * blockSize + (blockSize - 1) / 2);
 
-                double numerator = 0.0;
-                double denumerator = 0.0;
+            double numerator = 0.0;
+            double denumerator = 0.0;
 
+            for (int kernelY = -kernelSize / 2; kernelY <= kernelSize / 2; kernelY++)
+            {
                 for (int kernelX = -kernelSize / 2; kernelX <= kernelSize / 2; kernelX++)
                 {
-                    for (int kernelY = -kernelSize / 2; kernelY <= kernelSize / 2; kernelY++)
+                    int currentPixelX = blockCenterX + kernelX;
+                    int currentPixelY = blockCenterY + kernelY;
+
+                    if (Image::isElementInMatSizeRange(currentPixelX, currentPixelY, img))
                     {
-                        int currentPixelX = blockCenterX + kernelX;
-                        int currentPixelY = blockCenterY + kernelY;
+                        int pixelsBlockX = currentPixelX / blockSize;
+                        int pixelsBlockY = currentPixelY / blockSize;
 
-                        if (Image::isElementInMatSizeRange(currentPixelX, currentPixelY, img))
+                        if (foregroundBlocks.isForeground(pixelsBlockX, pixelsBlockY))
                         {
-                            int pixelsBlockX = currentPixelX / blockSize;
-                            int pixelsBlockY = currentPixelY / blockSize;
-
-                            if (!BackgroundSubstractor::isBackgroundBlock(pixelsBlockX, pixelsBlockY, backgroundMask))
-                            {
-                                double currentPixelFreq = frequencyField.at<double>(pixelsBlockY, pixelsBlockX);
-                                double mu;
-                                double delta;
-                                (currentPixelFreq <= 0) ? mu = 0 : mu = currentPixelFreq;
-                                (currentPixelFreq + 1 <= 0) ? delta = 0 : delta = 1;
-
-                                numerator += gaussKernel.at<double>(kernelY + kernelSize / 2, kernelX + kernelSize / 2) * mu;
-                                denumerator += gaussKernel.at<double>(kernelY + kernelSize / 2, kernelX + kernelSize / 2) * delta;
-                            }
+                            double currentPixelFreq = frequencies(pixelsBlockX, pixelsBlockY);
+                            double mu;
+                            double delta;
+                            (currentPixelFreq <= 0) ? mu = 0 : mu = currentPixelFreq;
+                            (currentPixelFreq + 1 <= 0) ? delta = 0 : delta = 1;
+
+                            numerator += gaussKernel.at<double>(kernelY + kernelSize / 2, kernelX + kernelSize / 2) * mu;
+                            denumerator += gaussKernel.at<double>(kernelY + kernelSize / 2, kernelX + kernelSize / 2) * delta;
                         }
                     }
                 }
-                if (denumerator != 0)
-                {
-                    enhancedFrequencyField.at<double>(blockY, blockX) = numerator / denumerator;
-                }
+            }
+            if (denumerator != 0)
+            {
+                enhancedFrequencies(blockX, blockY) = numerator / denumerator;
             }
         }
     }
 
-    enhancedFrequencyField.copyTo(frequencyField);
+    enhancedFrequencies.getMat().copyTo(frequencyField);
 }
 
 
-vector<int> FrequencyEstimator::findLocalMax(vector<double>& values)
+/**
+ * masks of strict local maxima and minima of every row, 255 at extreme
+ * mask column c belongs to signature value c + 1, first and last value cannot be extreme
+ */
+void FrequencyEstimator::findLocalExtremes(const cv::Mat& signatures, cv::Mat& maxMask, cv::Mat& minMask)
 {
-    vector<int> maxIndexes;
-
-    for (int i = 1; i < values.size() - 1; i++)
-    {
-        if (values.at(i) > values.at(i - 1) && values.at(i) > values.at(i + 1))
-        {
-            maxIndexes.push_back(i);
-        }
-    }
-    return maxIndexes;
+    int width = signatures.cols;
+    cv::Mat center = signatures.colRange(1, width - 1);
+    cv::Mat left = signatures.colRange(0, width - 2);
+    cv::Mat right = signatures.colRange(2, width);
+    cv::Mat rightComparison;
+
+    cv::compare(center, left, maxMask, cv::CMP_GT);
+    cv::compare(center, right, rightComparison, cv::CMP_GT);
+    cv::bitwise_and(maxMask, rightComparison, maxMask);
+
+    cv::compare(center, left, minMask, cv::CMP_LT);
+    cv::compare(center, right, rightComparison, cv::CMP_LT);
+    cv::bitwise_and(minMask, rightComparison, minMask);
 }
 
 
-vector<int> FrequencyEstimator::findLocalMin(vector<double>& values)
+/**
+ * mean distance between extremes of one signature, 0 if no common period can be estimated
+ * sum of distances between neighboring extremes is distance between first and last one
+ */
+int FrequencyEstimator::estimatePeriod(const unsigned char* extremes, int length, int windowWidth)
 {
-    vector<int> minIndexes;
+    int count = 0, first = 0, previous = 0, maxDistance = 0;
 
-    for (int i = 1; i < values.size() - 1; i++)
+    for (int i = 0; i < length; i++)
     {
-        if (values.at(i) < values.at(i - 1) && values.at(i) < values.at(i + 1))
-        {
-            minIndexes.push_back(i);
-        }
-    }
-    return minIndexes;
-}
+        if (extremes[i] == 0)
+            continue;
 
+        if (count == 0)
+            first = i;
+        else if (i - previous > maxDistance)
+            maxDistance = i - previous;
 
-bool FrequencyEstimator::frequencyFound(vector<int>& indexes, int windowWidth)
-{
-    //no frequency can be estimated (too little values)
-    if (indexes.empty() || indexes.size() == 1)
-    {
-        return false;
+        previous = i;
+        count++;
     }
 
-    //estimate mean distance between local extremes (period)
-    int stdDistance = 0;
-    for (int i = 0; i < indexes.size() - 1; i++)
-    {
-        //is not last element
-        stdDistance += indexes.at(i + 1) - indexes.at(i);
-    }
+    //no frequency can be estimated (too little values)
+    if (count < 2)
+        return 0;
 
-    stdDistance /= (static_cast<int>(indexes.size()) - 1);
+    int stdDistance = (previous - first) / (count - 1);
 
     //check if a common period can be estimated
-    for (int i = 0; i < indexes.size() - 1; i++)
-    {
-        int distance = indexes.at(i + 1) - indexes.at(i);
-
-        if (distance > stdDistance + (windowWidth / 9))
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
+    if (maxDistance > stdDistance + (windowWidth / 9))
+        return 0;
 
-
-int FrequencyEstimator::getPeriodLenght(vector<int>& indexes)
-{
-    //estimate mean distance between extremes (period)
-    int stdDistance = 0;
-    for (int i = 0; i < indexes.size() - 1; i++)
-    {
-        stdDistance += indexes.at(i + 1) - indexes.at(i);
-    }
-
-    stdDistance /= (static_cast<int>(indexes.size()) - 1);
     return stdDistance;
 }
 
@@ -267,114 +211,120 @@ cv::Mat FrequencyEstimator::drawFrequencyField(Image* image)
     cv::Mat img;
     image->getProcessedImage().copyTo(img);
     int blockSize = image->getBlockSize();
-    cv::Mat frequencyField = image->getFrequencyField();
+    BlockGrid<double> frequencyField(image->getFrequencyField());
 
-    for (int imgX = 0; imgX < img.cols; imgX++)
+    for (int imgY = 0; imgY < img.rows; imgY++)
     {
-        for (int imgY = 0; imgY < img.rows; imgY++)
+        unsigned char* pixelRow = img.ptr<unsigned char>(imgY);
+        const double* blockRow = frequencyField.row(imgY / blockSize);
+
+        for (int imgX = 0; imgX < img.cols; imgX++)
         {
-            int blockCoordX = imgX / blockSize;
-            int blockCoordY = imgY / blockSize;
-            int correspondingBlockFreq = static_cast<int>(frequencyField.at<double>(blockCoordY, blockCoordX) * 255);
+            int correspondingBlockFreq = static_cast<int>(blockRow[imgX / blockSize] * 255);
             if (correspondingBlockFreq == -255)
             {
                 //frequency could not be estimated for this block
                 correspondingBlockFreq = 255; //white
             }
-            img.at<unsigned char>(imgY, imgX) = correspondingBlockFreq;
+            pixelRow[imgX] = correspondingBlockFreq;
         }
     }
 
     return img;
 }
 
-cv::Mat FrequencyEstimator::extendMatrixSizeBlockwiseAndInterpBorders(const cv::Mat& mat, const cv::Size& size, int blockSize)
+//unknown frequency takes the highest frequency of its 3x3 neighborhood
+cv::Mat FrequencyEstimator::interpolateBorderBlocks(const cv::Mat& mat)
 {
-	cv::Mat freqFieldFullSize = cv::Mat::zeros(size, CV_64F);
+	BlockGrid<double> frequencies(mat);
+	BlockGrid<double> interpolated(frequencies.getWidth(), frequencies.getHeight());
 
-	//extend matrix to the size of original image for better averaging
-	for (int i = 0; i < freqFieldFullSize.cols; i++) {
-		for (int j = 0; j < freqFieldFullSize.rows; j++) {
-			double blockFreq = mat.at<double>(j / blockSize, i / blockSize);
+	for (int blockY = 0; blockY < frequencies.getHeight(); blockY++) {
+		for (int blockX = 0; blockX < frequencies.getWidth(); blockX++) {
+			double blockFreq = frequencies(blockX, blockY);
 
 			if (blockFreq == -1) {
-				for (int u = -1; u <= 1; u++) {
-					for (int v = -1; v <= 1; v++) {
-						if (Image::isElementInMatSizeRange(i / blockSize + u, j / blockSize + v, mat)) {
-							double neighFreqValue = mat.at<double>(j / blockSize + v, i / blockSize + u);
-							if (neighFreqValue > blockFreq) {
-								blockFreq = neighFreqValue;
-							}
+				for (int v = -1; v <= 1; v++) {
+					for (int u = -1; u <= 1; u++) {
+						double neighFreqValue = frequencies.getOrDefault(blockX + u, blockY + v, -1);
+						if (neighFreqValue > blockFreq) {
+							blockFreq = neighFreqValue;
 						}
 					}
 				}
 			}
-			freqFieldFullSize.at<double>(j, i) = blockFreq;
+			interpolated(blockX, blockY) = blockFreq;
 		}
 	}
 
-	return freqFieldFullSize;
+	return interpolated.getMat();
 }
 
 
-bool FrequencyEstimator::isNotOutOfRange(int index, size_t size)
+cv::Mat FrequencyEstimator::extendMatrixSizeBlockwiseAndInterpBorders(const cv::Mat& mat, const cv::Size& size, int blockSize)
 {
-    if (index < 0 || index >= size)
-    {
-        return false;
-    }
-    return true;
+	cv::Mat freqFieldFullSize(size, CV_PIXEL);
+	BlockGrid<double> frequencies(interpolateBorderBlocks(mat));
+
+	//extend matrix to the size of original image for better averaging
+	for (int j = 0; j < freqFieldFullSize.rows; j++) {
+		pixel_t* pixelRow = freqFieldFullSize.ptr<pixel_t>(j);
+		const double* blockRow = frequencies.row(j / blockSize);
+
+		for (int i = 0; i < freqFieldFullSize.cols; i++) {
+			pixelRow[i] = static_cast<pixel_t>(blockRow[i / blockSize]);
+		}
+	}
+
+	return freqFieldFullSize;
 }
 
 
 void FrequencyEstimator::smoothenFrequencyField(Image* image)
 {
     cv::Mat img = image->getProcessedImage();
-    cv::Mat backgroundMask = image->getBackgroundMask();
 	cv::Mat frequencyField = image->getFrequencyField();
     int blockSize = image->getBlockSize();
 
-    cv::Mat smoothedFrequencyField = cv::Mat::zeros(img.size(), CV_64F);
-    cv::Mat smoothedBlockFrequencyField = cv::Mat::zeros(frequencyField.size(), CV_64F);
+    BlockGrid<double> smoothedBlockFrequencyField(frequencyField.cols, frequencyField.rows, 0.);
 
     int kernelSize = 2 * blockSize;
-    cv::Mat gaussKernel = Filter::get2DGaussianKernel(kernelSize, kernelSize, 20, 20);
 
+#if FULL_RESOLUTION_SMOOTHING
+    cv::Mat smoothedFrequencyField = image->acquireBuffer(SMOOTHED_FREQUENCY, img.size(), CV_PIXEL);
 	cv::Mat freqFieldFullSize = extendMatrixSizeBlockwiseAndInterpBorders(frequencyField, img.size(), blockSize);
 
-	cv::filter2D(freqFieldFullSize, smoothedFrequencyField, CV_64F, gaussKernel);
+	Filter::smoothenGaussian(freqFieldFullSize, smoothedFrequencyField, kernelSize, 20);
 
     //average values of frequencies per each block
-    for (int i = 0; i < frequencyField.cols; i++)
+    for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
     {
-        for (int j = 0; j < frequencyField.rows; j++)
-        {
-            if (!BackgroundSubstractor::isBackgroundBlock(i, j, backgroundMask))
-            {
-                smoothedBlockFrequencyField.at<double>(j, i) = OrientationsEstimator::calcAvgForBlock(
-                    smoothedFrequencyField, blockSize, i, j);
-            }
-        }
+        smoothedBlockFrequencyField(block) = OrientationsEstimator::calcAvgForBlock(
+            smoothedFrequencyField, blockSize, block.x, block.y);
+    }
+#else
+    //same result as full size convolution averaged per block, computed on blocks only
+    cv::Mat smoothedFrequencyField;
+    Filter::smoothenBlockField(interpolateBorderBlocks(frequencyField), smoothedFrequencyField, kernelSize, 20, blockSize);
+    BlockGrid<double> smoothedFrequencies(smoothedFrequencyField);
+
+    for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
+    {
+        smoothedBlockFrequencyField(block) = smoothedFrequencies(block);
     }
+#endif
 
-    image->setFrequencyField(smoothedBlockFrequencyField);
+    image->setFrequencyField(smoothedBlockFrequencyField.getMat());
 }
 
 
-vector<double> FrequencyEstimator::smoothenSignatures(vector<double>& xSignatures, int kernelSize, int sigma) {
-	cv::Mat gaussKernel = cv::getGaussianKernel(kernelSize, sigma);
-	vector<double> newSignatures;
+/**
+ * smooths every row, taps -kernelSize / 2 .. kernelSize / 2 - 1 of gaussian kernel are used
+ * and values outside of signature count as zero
+ */
+void FrequencyEstimator::smoothenSignatures(const cv::Mat& signatures, cv::Mat& smoothedSignatures, int kernelSize, int sigma) {
+	cv::Mat gaussKernel = GaussianKernelCache::get1D(kernelSize, sigma, CV_64F);
+	cv::Mat kernelRow = gaussKernel.rowRange(0, kernelSize / 2 * 2).t();
 
-	//for each value at i
-	for (int i = 0; i < xSignatures.size(); i++) {
-		double newSign = 0;
-		for (int j = -kernelSize / 2; j < kernelSize / 2; j++) {
-			if (isNotOutOfRange(i + j, xSignatures.size())) {
-				//convolve with gaussian kernel
-				newSign += xSignatures[i + j] * gaussKernel.at<double>(j + kernelSize / 2);
-			}
-		}
-		newSignatures.push_back(newSign);
-	}
-	return newSignatures;
+	cv::filter2D(signatures, smoothedSignatures, CV_64F, kernelRow, cv::Point(kernelSize / 2, 0), 0, cv::BORDER_CONSTANT);
 }
@@ -1,20 +1,19 @@
 #pragma once
 
 #include "Image.h"
+#include "BlockGrid.h"
 
 class FrequencyEstimator
 {
 private:
-    vector<int> findLocalMax(vector<double>& values);
-	vector<int> findLocalMin(vector<double>& values);
-    bool frequencyFound(vector<int>& indexes, int windowWidth);
-    int getPeriodLenght(vector<int>& indexes);
-    void interpolateFreqField(cv::Mat img, cv::Mat frequencyField, int blockSize, cv::Mat backgroundMask);
+    void findLocalExtremes(const cv::Mat& signatures, cv::Mat& maxMask, cv::Mat& minMask);
+    int estimatePeriod(const unsigned char* extremes, int length, int windowWidth);
 public:
+    void interpolateFreqField(cv::Mat img, cv::Mat frequencyField, int blockSize, const ForegroundBlockIndex& foregroundBlocks);
     FrequencyEstimator();
-    bool isNotOutOfRange(int index, size_t size);
-    vector<double> smoothenSignatures(vector<double>& xSignatures, int kernelSize, int sigma);
+    void smoothenSignatures(const cv::Mat& signatures, cv::Mat& smoothedSignatures, int kernelSize, int sigma);
     void computeFrequencyField(Image* image);
+    cv::Mat interpolateBorderBlocks(const cv::Mat& mat);
     cv::Mat extendMatrixSizeBlockwiseAndInterpBorders(const cv::Mat& mat, const cv::Size& size, int blockSize);
     void smoothenFrequencyField(Image* image);
     static cv::Mat drawFrequencyField(Image* image);
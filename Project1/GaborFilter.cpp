@@ -1,6 +1,23 @@
 #include "GaborFilter.h"
 #include "OrientationsEstimator.h"
 #include "BackgroundSubstractor.h"
+#include "GaborKernelCache.h"
+#include <algorithm>
+#include <limits>
+#include <opencv2/core/hal/intrin.hpp>
+
+//vector of pixel_t values for the direct convolution
+#if SINGLE_PRECISION && CV_SIMD128
+#define DIRECT_GABOR_SIMD 1
+typedef cv::v_float32x4 v_pixel;
+static inline v_pixel v_setall_pixel(pixel_t value) { return cv::v_setall_f32(value); }
+#elif !SINGLE_PRECISION && CV_SIMD128_64F
+#define DIRECT_GABOR_SIMD 1
+typedef cv::v_float64x2 v_pixel;
+static inline v_pixel v_setall_pixel(pixel_t value) { return cv::v_setall_f64(value); }
+#else
+#define DIRECT_GABOR_SIMD 0
+#endif
 
 
 GaborFilter::GaborFilter()
@@ -8,24 +25,30 @@ GaborFilter::GaborFilter()
 }
 
 
-void GaborFilter::setup(Image* image)
+void GaborFilter::setup(Image* image, Image* bankImage)
 {
-	//copy given image with all features to attributes
-    this->srcImage = *image;
+	//features are read directly from given image, it has to outlive the filter
+    this->srcImage = image;
+	this->bankImage = (bankImage != nullptr) ? bankImage : image;
+	this->spectrumKernelId = NO_KERNEL;
 
+#if !GLOBAL_GABOR_BANK && !PERIOD_ADAPTIVE_GABOR
+	//bank spans orientations and frequencies of bank image only
 	createBankOfGaborFilters();
+#endif
 }
 
 void GaborFilter::createBankOfGaborFilters()
 {
-	cv::Mat orientationField = this->srcImage.getOrientationField();
-	cv::Mat frequencyField = this->srcImage.getFrequencyField();
-	cv::Mat backgroundMask = this->srcImage.getBackgroundMask();
+	cv::Mat orientationField = this->bankImage->getOrientationField();
+	cv::Mat frequencyField = this->bankImage->getFrequencyField();
+	const vector<cv::Point>& foregroundBlocks = this->bankImage->getForegroundBlocks().getBlocks();
 
-	double maxOrientation = getMaxInMatWithValidityMask(orientationField, backgroundMask);
-	double minOrientation = getMinInMatWithValidityMask(orientationField, backgroundMask);
-	double maxFrequency = getMaxInMatWithValidityMask(frequencyField, backgroundMask);
-	double minFrequency = getMinInMatWithValidityMask(frequencyField, backgroundMask);
+	double maxOrientation = getMaxInMatAtBlocks(orientationField, foregroundBlocks);
+	double minOrientation = getMinInMatAtBlocks(orientationField, foregroundBlocks);
+	double maxFrequency = getMaxInMatAtBlocks(frequencyField, foregroundBlocks);
+	double minFrequency = getMinInMatAtBlocks(frequencyField, foregroundBlocks);
+	PipelineWorkspace* workspace = this->srcImage->getWorkspace();
 
 	//determine step between field and frequency of filters in bank
 	double bankOrientationStep = (maxOrientation - minOrientation) / BANK_SIZE;
@@ -45,11 +68,16 @@ void GaborFilter::createBankOfGaborFilters()
 		for (int bankY = 0; bankY < BANK_SIZE; bankY++) {
 			bankFiltersFrequencies.push_back(currentFilterFreq);
 
+			//bank storage is reused from worker workspace when available
+			cv::Mat& currentFilter = (workspace != nullptr) ?
+				workspace->getKernel(bankX * BANK_SIZE + bankY, this->kernelSize, CV_PIXEL) : this->gaborFilterBank[bankX][bankY];
+			currentFilter.create(this->kernelSize, CV_PIXEL);
+
 			//create gabor kernel according to field and frequency 
 			double currentFilterOrientNormalRad = (currentFilterOrient - 90) * CV_PI / 180;
-			cv::Mat currentFilter = cv::getGaborKernel(this->kernelSize, this->stdDev,
-				currentFilterOrientNormalRad, 1. / currentFilterFreq, this->aspectRatio, this->offset, CV_64F);
-			currentFilter.copyTo(this->gaborFilterBank[bankX][bankY]);
+			fillGaborKernel(currentFilter, this->stdDev, currentFilterOrientNormalRad, 1. / currentFilterFreq,
+				this->aspectRatio, this->offset);
+			this->gaborFilterBank[bankX][bankY] = currentFilter;
 
 			//cv::imshow("a", currentFilter);
 			//cv::waitKey(20);
@@ -62,71 +90,431 @@ void GaborFilter::createBankOfGaborFilters()
 	//save filters parameters
 	this->bankFiltersOrientations = bankFiltersOrientations;
 	this->bankFiltersFrequencies = bankFiltersFrequencies;
+
+	//blocks pick their filter by table lookup instead of searching the bank
+	for (int bin = 0; bin < ORIENTATION_BINS; bin++) {
+		this->orientationBankIndex[bin] = static_cast<unsigned char>(getClosestValueIndex(
+			FieldQuantizer::orientationToDegrees(static_cast<unsigned char>(bin)), this->bankFiltersOrientations));
+	}
+	for (int period = 0; period < PERIOD_BINS; period++) {
+		this->periodBankIndex[period] = static_cast<unsigned char>(getClosestValueIndex(
+			FieldQuantizer::periodToFrequency(static_cast<unsigned char>(period)), this->bankFiltersFrequencies));
+	}
 }
 
 void GaborFilter::filter() 
 {
-	cv::Mat sourceImage;
-	this->srcImage.getProcessedImage().convertTo(sourceImage, CV_64F);
-	cv::Mat processedImage = cv::Mat::zeros(sourceImage.size(), CV_8U);
-	cv::Mat orientationField = this->srcImage.getOrientationField();
-	cv::Mat frequencyField = this->srcImage.getFrequencyField();
-	cv::Mat backgroundMask = this->srcImage.getBackgroundMask();
-	cv::Mat qualityMap = this->srcImage.getQualityMap();
-	int blockSize = this->srcImage.getBlockSize();
-
-    //filter
-    for(int blockX = 0; blockX < sourceImage.cols / blockSize; blockX++)
+	cv::Size imageSize = this->srcImage->getProcessedImage().size();
+	cv::Mat sourceImage = this->srcImage->acquireBuffer(FILTER_SOURCE, imageSize, CV_PIXEL);
+	this->srcImage->getProcessedImage().convertTo(sourceImage, CV_PIXEL);
+	cv::Mat processedImage = this->srcImage->acquireBuffer(FILTER_RESULT, imageSize, CV_8U);
+	processedImage.setTo(0);
+	BlockGrid<unsigned char> orientationBins(this->srcImage->getQuantizedOrientationField());
+	BlockGrid<unsigned char> periods(this->srcImage->getPeriodField());
+	cv::Mat qualityMap = this->srcImage->getQualityMap();
+	int blockSize = this->srcImage->getBlockSize();
+
+	//bank filter of every block that is filtered, others stay NO_KERNEL
+	BlockGrid<int> kernelIds(orientationBins.getWidth(), orientationBins.getHeight(), NO_KERNEL);
+
+    //filter foreground only, background stays black
+    for(const cv::Point& block : this->srcImage->getForegroundBlocks().getBlocks())
     {
-		for (int blockY = 0; blockY < sourceImage.rows / blockSize; blockY++)
-		{
-            if(BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
-            {   
-                //skip background
-				continue;
-            }
+		int blockX = block.x;
+		int blockY = block.y;
 
+        if(qualityMap.at<double>(blockY, blockX) > 0.5)
+        {
 			//extract only currently processed block
 			auto blockBoundaries = cv::Rect(blockX * blockSize, blockY * blockSize, blockSize, blockSize);
 			cv::Mat extractedBlock = sourceImage(blockBoundaries);
 
-            if(qualityMap.at<double>(blockY, blockX) > 0.5)
-            {
-				double min, max;
-				cv::minMaxLoc(extractedBlock, &min, &max);
+			double min, max;
+			cv::minMaxLoc(extractedBlock, &min, &max);
 
-				extractedBlock.convertTo(processedImage(blockBoundaries), CV_8U, 255.0 / (max - min), min * 255.0 / (min - max));
-            }
-			else {
-				//choose the right filter kernel according to field and frequency
-				double blockOrientation = orientationField.at<double>(blockY, blockX);
-				double blockFrequency = frequencyField.at<double>(blockY, blockX);
+			extractedBlock.convertTo(processedImage(blockBoundaries), CV_8U, 255.0 / (max - min), min * 255.0 / (min - max));
+        }
+		else {
+			//choose the right filter kernel according to field and frequency
+			kernelIds(block) = getKernelId(orientationBins(block), periods(block));
+		}
+    }
 
-				int closestOrientIndex = getClosestValueIndex(blockOrientation, this->bankFiltersOrientations);
-				int closestFreqIndex = getClosestValueIndex(blockFrequency, this->bankFiltersFrequencies);
+#if GROUPED_GABOR_DISPATCH
+	//one convolution per rectangle, rectangles of the same kernel follow each other
+	for (const KernelRun& run : groupBlocksByKernel(kernelIds))
+	{
+		filterBlocks(sourceImage, processedImage, run.blocks, run.kernelId);
+	}
+#else
+	for (const cv::Point& block : this->srcImage->getForegroundBlocks().getBlocks())
+	{
+		if (kernelIds(block) != NO_KERNEL)
+			filterBlocks(sourceImage, processedImage, cv::Rect(block.x, block.y, 1, 1), kernelIds(block));
+	}
+#endif
 
-				cv::Mat gaborKernel = this->gaborFilterBank[closestOrientIndex][closestFreqIndex];
+	processedImage.copyTo(this->processedImage);
+}
+
+
+/**
+ * convolution of rectangle of blocks reads pixels around it from the whole image,
+ * so every block gets the same values as when it is filtered alone
+ * each block is then converted to range 0 - 255 separately
+ */
+void GaborFilter::filterBlocks(const cv::Mat& sourceImage, cv::Mat& processedImage, const cv::Rect& blocks, int kernelId)
+{
+	int blockSize = this->srcImage->getBlockSize();
+	cv::Rect pixels(blocks.x * blockSize, blocks.y * blockSize, blocks.width * blockSize, blocks.height * blockSize);
+	cv::Mat gaborKernel = getKernel(kernelId);
+
+#if DIRECT_GABOR_CONVOLUTION
+	//whole kernel neighborhood has to be inside the image, border blocks are left to filter2D
+	cv::Rect neighborhood(pixels.x - gaborKernel.cols / 2, pixels.y - gaborKernel.rows / 2,
+		pixels.width + gaborKernel.cols - 1, pixels.height + gaborKernel.rows - 1);
+
+	if (gaborKernel.cols <= DIRECT_GABOR_MAX_KERNEL && gaborKernel.rows <= DIRECT_GABOR_MAX_KERNEL &&
+		(neighborhood & cv::Rect(cv::Point(0, 0), sourceImage.size())) == neighborhood)
+	{
+		filterBlocksDirect(sourceImage, processedImage, pixels, gaborKernel);
+		return;
+	}
+#endif
+
+	cv::Mat filteredBlocks = this->srcImage->acquireBuffer(FILTERED_BLOCK, pixels.size(), CV_PIXEL);
 
-				//filter block
-				cv::Mat filteredBlock;
-				cv::filter2D(extractedBlock, filteredBlock, CV_64F, gaborKernel);
+	//cost of frequency domain convolution does not grow with kernel area
+	if (gaborKernel.cols >= FFT_GABOR_MIN_KERNEL)
+		convolveSpectral(sourceImage, pixels, kernelId, gaborKernel, filteredBlocks);
+	else
+		cv::filter2D(sourceImage(pixels), filteredBlocks, CV_PIXEL, gaborKernel);
 
-				//convert to needed range 0 - 255
-				filteredBlock = abs(filteredBlock);
+	//convert to needed range 0 - 255
+	cv::absdiff(filteredBlocks, cv::Scalar::all(0), filteredBlocks);
+
+	for (int blockY = 0; blockY < blocks.height; blockY++)
+	{
+		for (int blockX = 0; blockX < blocks.width; blockX++)
+		{
+			cv::Rect blockInRun(blockX * blockSize, blockY * blockSize, blockSize, blockSize);
+			cv::Mat filteredBlock = filteredBlocks(blockInRun);
+
+			double min, max;
+			cv::minMaxLoc(filteredBlock, &min, &max);
+
+			//save filtered block to processed image matrix
+			cv::Rect blockBoundaries(pixels.x + blockInRun.x, pixels.y + blockInRun.y, blockSize, blockSize);
+			filteredBlock.convertTo(processedImage(blockBoundaries), CV_8U, 255.0 / (max - min), min * 255.0 / (min - max));
+		}
+	}
+}
 
-				double min, max;
-				cv::minMaxLoc(filteredBlock, &min, &max);
 
-				cv::Mat convertedFilteredBlock;
-				filteredBlock.convertTo(convertedFilteredBlock, CV_8U, 255.0 / (max - min), min * 255.0 / (min - max));
+/**
+ * same result as filter2D, absdiff, minMaxLoc and convertTo of filterBlocks
+ * response of a block is kept in workspace buffer only until the block is rescaled into processed image
+ */
+void GaborFilter::filterBlocksDirect(const cv::Mat& sourceImage, cv::Mat& processedImage, const cv::Rect& pixels, const cv::Mat& gaborKernel)
+{
+	int blockSize = this->srcImage->getBlockSize();
+	int kernelWidth = gaborKernel.cols;
+	int kernelHeight = gaborKernel.rows;
+	size_t sourceStep = sourceImage.step1();
+	cv::Mat response = this->srcImage->acquireBuffer(FILTERED_BLOCK, cv::Size(blockSize, blockSize), CV_PIXEL);
+
+	//kernel coefficients broadcast once for all blocks of the rectangle
+	pixel_t coefficients[DIRECT_GABOR_MAX_KERNEL * DIRECT_GABOR_MAX_KERNEL];
+	for (int ky = 0; ky < kernelHeight; ky++)
+	{
+		for (int kx = 0; kx < kernelWidth; kx++)
+			coefficients[ky * kernelWidth + kx] = gaborKernel.at<pixel_t>(ky, kx);
+	}
+#if DIRECT_GABOR_SIMD
+	v_pixel vCoefficients[DIRECT_GABOR_MAX_KERNEL * DIRECT_GABOR_MAX_KERNEL];
+	for (int tap = 0; tap < kernelWidth * kernelHeight; tap++)
+		vCoefficients[tap] = v_setall_pixel(coefficients[tap]);
+#endif
+
+	for (int blockTop = pixels.y; blockTop < pixels.br().y; blockTop += blockSize)
+	{
+		for (int blockLeft = pixels.x; blockLeft < pixels.br().x; blockLeft += blockSize)
+		{
+			pixel_t min = std::numeric_limits<pixel_t>::max();
+			pixel_t max = 0;
+#if DIRECT_GABOR_SIMD
+			v_pixel vMin = v_setall_pixel(min);
+			v_pixel vMax = v_setall_pixel(max);
+#endif
+
+			//absolute response and its range
+			for (int y = 0; y < blockSize; y++)
+			{
+				const pixel_t* window = sourceImage.ptr<pixel_t>(blockTop + y - kernelHeight / 2) + blockLeft - kernelWidth / 2;
+				pixel_t* responseRow = response.ptr<pixel_t>(y);
+				int x = 0;
+
+#if DIRECT_GABOR_SIMD
+				for (; x <= blockSize - v_pixel::nlanes; x += v_pixel::nlanes)
+				{
+					v_pixel sum = v_setall_pixel(0);
+					for (int ky = 0; ky < kernelHeight; ky++)
+					{
+						const pixel_t* sourceRow = window + ky * sourceStep + x;
+						const v_pixel* kernelRow = vCoefficients + ky * kernelWidth;
+
+						for (int kx = 0; kx < kernelWidth; kx++)
+							sum = cv::v_muladd(cv::v_load(sourceRow + kx), kernelRow[kx], sum);
+					}
+
+					sum = cv::v_abs(sum);
+					vMin = cv::v_min(vMin, sum);
+					vMax = cv::v_max(vMax, sum);
+					cv::v_store(responseRow + x, sum);
+				}
+#endif
+				for (; x < blockSize; x++)
+				{
+					pixel_t sum = 0;
+					for (int ky = 0; ky < kernelHeight; ky++)
+					{
+						const pixel_t* sourceRow = window + ky * sourceStep + x;
+						const pixel_t* kernelRow = coefficients + ky * kernelWidth;
+
+						for (int kx = 0; kx < kernelWidth; kx++)
+							sum += sourceRow[kx] * kernelRow[kx];
+					}
+
+					sum = abs(sum);
+					min = std::min(min, sum);
+					max = std::max(max, sum);
+					responseRow[x] = sum;
+				}
+			}
 
-				//save filtered block to processed image matrix
-				convertedFilteredBlock.copyTo(processedImage(blockBoundaries));
+#if DIRECT_GABOR_SIMD
+			pixel_t lanes[v_pixel::nlanes];
+			cv::v_store(lanes, vMin);
+			for (int lane = 0; lane < v_pixel::nlanes; lane++)
+				min = std::min(min, lanes[lane]);
+			cv::v_store(lanes, vMax);
+			for (int lane = 0; lane < v_pixel::nlanes; lane++)
+				max = std::max(max, lanes[lane]);
+#endif
+
+			//rescale to range 0 - 255 straight into processed image
+			double scale = 255.0 / (max - min);
+			double shift = min * 255.0 / (min - max);
+
+			for (int y = 0; y < blockSize; y++)
+			{
+				const pixel_t* responseRow = response.ptr<pixel_t>(y);
+				unsigned char* processedRow = processedImage.ptr<unsigned char>(blockTop + y) + blockLeft;
+
+				for (int x = 0; x < blockSize; x++)
+					processedRow[x] = cv::saturate_cast<unsigned char>(responseRow[x] * scale + shift);
 			}
 		}
-    }
+	}
+}
 
-	processedImage.copyTo(this->processedImage);
+
+/**
+ * same result as filter2D, rectangle is split to tiles and each tile is transformed with the kernel neighborhood around it,
+ * neighboring tiles overlap by the kernel size and only the part without wrap-around is kept
+ * all tiles of the rectangle share one transform size, so the kernel spectrum is computed once per kernel
+ */
+void GaborFilter::convolveSpectral(const cv::Mat& sourceImage, const cv::Rect& pixels, int kernelId, const cv::Mat& gaborKernel, cv::Mat& filteredBlocks)
+{
+	cv::Size halo(gaborKernel.cols - 1, gaborKernel.rows - 1);
+	cv::Size tileSize(std::min(pixels.width, FFT_GABOR_TILE), std::min(pixels.height, FFT_GABOR_TILE));
+	cv::Size dftSize(cv::getOptimalDFTSize(tileSize.width + halo.width), cv::getOptimalDFTSize(tileSize.height + halo.height));
+	cv::Rect imageBoundaries(cv::Point(0, 0), sourceImage.size());
+
+	if (kernelId != this->spectrumKernelId || dftSize != this->spectrumSize)
+	{
+		cv::Mat paddedKernel = cv::Mat::zeros(dftSize, CV_PIXEL);
+		gaborKernel.copyTo(paddedKernel(cv::Rect(cv::Point(0, 0), gaborKernel.size())));
+		cv::dft(paddedKernel, this->kernelSpectrum, 0, gaborKernel.rows);
+
+		this->spectrumKernelId = kernelId;
+		this->spectrumSize = dftSize;
+	}
+
+	cv::Mat tile = this->srcImage->acquireBuffer(FFT_TILE, dftSize, CV_PIXEL);
+
+	for (int tileY = 0; tileY < pixels.height; tileY += tileSize.height)
+	{
+		for (int tileX = 0; tileX < pixels.width; tileX += tileSize.width)
+		{
+			cv::Rect output(tileX, tileY, std::min(tileSize.width, pixels.width - tileX), std::min(tileSize.height, pixels.height - tileY));
+
+			//kernel neighborhood of the tile, outside of the image it is reflected like in filter2D
+			cv::Rect neighborhood(pixels.x + output.x - gaborKernel.cols / 2, pixels.y + output.y - gaborKernel.rows / 2,
+				output.width + halo.width, output.height + halo.height);
+			cv::Rect inside = neighborhood & imageBoundaries;
+
+			tile.setTo(0);
+			cv::copyMakeBorder(sourceImage(inside), tile(cv::Rect(cv::Point(0, 0), neighborhood.size())),
+				inside.y - neighborhood.y, neighborhood.br().y - inside.br().y,
+				inside.x - neighborhood.x, neighborhood.br().x - inside.br().x, cv::BORDER_REFLECT_101);
+
+			//correlation like filter2D, result at (0, 0) belongs to the first output pixel
+			cv::dft(tile, tile, 0, neighborhood.height);
+			cv::mulSpectrums(tile, this->kernelSpectrum, tile, 0, true);
+			cv::idft(tile, tile, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, output.height);
+
+			tile(cv::Rect(cv::Point(0, 0), output.size())).copyTo(filteredBlocks(output));
+		}
+	}
+}
+
+
+//largest distance from block that filter reads, also for period adaptive kernels
+int GaborFilter::getMaxKernelRadius()
+{
+#if PERIOD_ADAPTIVE_GABOR
+	return std::max(GABOR_KERNEL_SIZE / 2, cvCeil(3 * ADAPTIVE_SIGMA_PERIODS * PERIOD_MAX));
+#else
+	return GABOR_KERNEL_SIZE / 2;
+#endif
+}
+
+
+int GaborFilter::getKernelId(unsigned char orientationBin, unsigned char period)
+{
+#if GLOBAL_GABOR_BANK || PERIOD_ADAPTIVE_GABOR
+	return (orientationBin >> GLOBAL_ORIENTATION_SHIFT) * GLOBAL_PERIODS + (period >> GLOBAL_PERIOD_SHIFT);
+#else
+	return this->orientationBankIndex[orientationBin] * BANK_SIZE + this->periodBankIndex[period];
+#endif
+}
+
+
+/**
+ * global kernels are created from the center of their grid cell and cached for the whole process,
+ * first cell of periods holds blocks without period and is filtered with zero frequency like the image bank
+ */
+cv::Mat GaborFilter::getKernel(int kernelId)
+{
+#if GLOBAL_GABOR_BANK || PERIOD_ADAPTIVE_GABOR
+	int orientationIndex = kernelId / GLOBAL_PERIODS;
+	int periodIndex = kernelId % GLOBAL_PERIODS;
+
+	double orientation = FieldQuantizer::orientationToDegrees(static_cast<unsigned char>(
+		(orientationIndex << GLOBAL_ORIENTATION_SHIFT) + (1 << GLOBAL_ORIENTATION_SHIFT) / 2));
+	double frequency = (periodIndex == 0) ? 0. : FieldQuantizer::periodToFrequency(static_cast<unsigned char>(
+		(periodIndex << GLOBAL_PERIOD_SHIFT) + (1 << GLOBAL_PERIOD_SHIFT) / 2));
+
+	int size = this->kernelSize.width;
+	double sigma = this->stdDev;
+
+#if PERIOD_ADAPTIVE_GABOR
+	//deviation is a fraction of ridge period, kernel reaches three deviations to both sides
+	if (frequency > 0)
+	{
+		sigma = ADAPTIVE_SIGMA_PERIODS / frequency;
+		size = std::max(size, 2 * cvCeil(3 * sigma) + 1);
+	}
+#endif
+
+	double orientationNormalRad = (orientation - 90) * CV_PI / 180;
+	return GaborKernelCache::get(size, sigma, orientationNormalRad, 1. / frequency,
+		this->aspectRatio, this->offset, CV_PIXEL);
+#else
+	return this->gaborFilterBank[kernelId / BANK_SIZE][kernelId % BANK_SIZE];
+#endif
+}
+
+
+/**
+ * horizontal runs of blocks with the same kernel, runs with the same columns in following rows are merged
+ * result is ordered by kernel, so each kernel stays in cache while its rectangles are filtered
+ */
+vector<KernelRun> GaborFilter::groupBlocksByKernel(const BlockGrid<int>& kernelIds)
+{
+	vector<KernelRun> runs;
+	vector<int> openRuns, currentRuns;
+
+	for (int blockY = 0; blockY < kernelIds.getHeight(); blockY++)
+	{
+		const int* idRow = kernelIds.row(blockY);
+		currentRuns.clear();
+
+		for (int blockX = 0; blockX < kernelIds.getWidth();)
+		{
+			int kernelId = idRow[blockX];
+			int runEnd = blockX + 1;
+			while (runEnd < kernelIds.getWidth() && idRow[runEnd] == kernelId)
+				runEnd++;
+
+			if (kernelId != NO_KERNEL)
+			{
+				//extend run of previous row with the same columns and kernel
+				int merged = -1;
+				for (int runIndex : openRuns)
+				{
+					const KernelRun& open = runs[runIndex];
+					if (open.kernelId == kernelId && open.blocks.x == blockX && open.blocks.width == runEnd - blockX)
+					{
+						merged = runIndex;
+						break;
+					}
+				}
+
+				if (merged >= 0)
+				{
+					runs[merged].blocks.height++;
+				}
+				else
+				{
+					merged = static_cast<int>(runs.size());
+					runs.push_back(KernelRun{ kernelId, cv::Rect(blockX, blockY, runEnd - blockX, 1) });
+				}
+				currentRuns.push_back(merged);
+			}
+
+			blockX = runEnd;
+		}
+
+		openRuns.swap(currentRuns);
+	}
+
+	stable_sort(runs.begin(), runs.end(), [](const KernelRun& a, const KernelRun& b) {
+		return a.kernelId < b.kernelId;
+	});
+
+	return runs;
+}
+
+
+/**
+ * same kernel as cv::getGaborKernel, written to already allocated matrix
+ */
+void GaborFilter::fillGaborKernel(cv::Mat& kernel, double sigma, double theta, double lambda, double gamma, double psi)
+{
+	double sigmaX = sigma;
+	double sigmaY = sigma / gamma;
+	int xMax = kernel.cols / 2;
+	int yMax = kernel.rows / 2;
+	double c = cos(theta);
+	double s = sin(theta);
+	double ex = -0.5 / (sigmaX * sigmaX);
+	double ey = -0.5 / (sigmaY * sigmaY);
+	double cscale = CV_PI * 2 / lambda;
+
+	for (int y = -yMax; y <= yMax; y++)
+	{
+		pixel_t* kernelRow = kernel.ptr<pixel_t>(yMax - y);
+
+		for (int x = -xMax; x <= xMax; x++)
+		{
+			double xr = x * c + y * s;
+			double yr = -x * s + y * c;
+
+			kernelRow[xMax - x] = static_cast<pixel_t>(exp(ex * xr * xr + ey * yr * yr) * cos(cscale * xr + psi));
+		}
+	}
 }
 
 
@@ -156,22 +544,16 @@ int GaborFilter::getClosestValueIndex(double value, const vector<double>& vector
 }
 
 
-double GaborFilter::getMaxInMatWithValidityMask(const cv::Mat& mat, const cv::Mat& validityMask) {
+double GaborFilter::getMaxInMatAtBlocks(const cv::Mat& mat, const vector<cv::Point>& blocks) {
 	double max = 0.;
 	bool firstValid = true;
 
-	for (int i = 0; i < mat.cols; i++) {
-		for (int j = 0; j < mat.rows; j++) {
-			if ((int)validityMask.at<unsigned char>(j, i) == 0) {
-				if (firstValid) {
-					max = mat.at<double>(j, i);
-					firstValid = false;
-				}
+	for (const cv::Point& block : blocks) {
+		double value = mat.at<double>(block);
 
-				if (mat.at<double>(j, i) > max) {
-					max = mat.at<double>(j, i);
-				}
-			}
+		if (firstValid || value > max) {
+			max = value;
+			firstValid = false;
 		}
 	}
 
@@ -179,22 +561,16 @@ double GaborFilter::getMaxInMatWithValidityMask(const cv::Mat& mat, const cv::Ma
 }
 
 
-double GaborFilter::getMinInMatWithValidityMask(const cv::Mat& mat, const cv::Mat& validityMask) {
+double GaborFilter::getMinInMatAtBlocks(const cv::Mat& mat, const vector<cv::Point>& blocks) {
 	double min = 0.;
 	bool firstValid = true;
 
-	for (int i = 0; i < mat.cols; i++) {
-		for (int j = 0; j < mat.rows; j++) {
-			if ((int)validityMask.at<unsigned char>(j, i) == 0) {
-				if (firstValid) {
-					min = mat.at<double>(j, i);
-					firstValid = false;
-				}
+	for (const cv::Point& block : blocks) {
+		double value = mat.at<double>(block);
 
-				if (mat.at<double>(j, i) < min) {
-					min = mat.at<double>(j, i);
-				}
-			}
+		if (firstValid || value < min) {
+			min = value;
+			firstValid = false;
 		}
 	}
 
@@ -1,12 +1,46 @@
 #pragma once
 #include "Filter.h"
+#include "FieldQuantizer.h"
+#include "BlockGrid.h"
 
 #define BANK_SIZE 20
+#define GABOR_KERNEL_SIZE 5
+#define NO_KERNEL -1
+
+//1 = neighboring blocks with the same bank filter are filtered together in one rectangle
+#define GROUPED_GABOR_DISPATCH 1
+
+//1 = fixed orientation and period grid shared by all images, kernels are built on first use
+#define GLOBAL_GABOR_BANK 0
+
+//global grid cell is 8 orientation bins (5.625 degrees) and 4 period bins (about 5.6 % of period)
+#define GLOBAL_ORIENTATION_SHIFT 3
+#define GLOBAL_PERIOD_SHIFT 2
+#define GLOBAL_ORIENTATIONS (ORIENTATION_BINS >> GLOBAL_ORIENTATION_SHIFT)
+#define GLOBAL_PERIODS (PERIOD_BINS >> GLOBAL_PERIOD_SHIFT)
+
+//1 = kernel size and deviation follow ridge period of the block, kernels are taken from the global grid
+#define PERIOD_ADAPTIVE_GABOR 0
+#define ADAPTIVE_SIGMA_PERIODS 0.5
+
+//kernels of this size and larger are convolved in frequency domain, tile is output size of one transform
+#define FFT_GABOR_MIN_KERNEL 15
+#define FFT_GABOR_TILE 64
+
+//1 = small kernels are convolved directly with absolute value, min, max and rescale in the same loops
+#define DIRECT_GABOR_CONVOLUTION 1
+#define DIRECT_GABOR_MAX_KERNEL 7
+
+//rectangle of blocks filtered by one bank filter, kernel id is orientation index * bank frequencies + frequency index
+typedef struct KernelRun {
+	int kernelId;
+	cv::Rect blocks;
+}KernelRun;
 
 class GaborFilter : public Filter
 {
 private:
-	cv::Size kernelSize = cv::Size(5, 5);
+	cv::Size kernelSize = cv::Size(GABOR_KERNEL_SIZE, GABOR_KERNEL_SIZE);
     double stdDev = 4.0;
 	double aspectRatio = 0.02;
 	double offset = 0;
@@ -14,14 +48,34 @@ private:
 	vector<double> bankFiltersFrequencies;
 	cv::Mat gaborFilterBank[BANK_SIZE][BANK_SIZE];
 
+	//not owned, its fields give range of the bank, whole image when a tile is filtered
+	Image* bankImage;
+
+	//closest bank filter for every quantized orientation and period
+	unsigned char orientationBankIndex[ORIENTATION_BINS];
+	unsigned char periodBankIndex[PERIOD_BINS];
+
+	//spectrum of the last kernel convolved in frequency domain
+	int spectrumKernelId = NO_KERNEL;
+	cv::Size spectrumSize;
+	cv::Mat kernelSpectrum;
+
 public:
     GaborFilter();
-	void setup(Image* image);
+	void setup(Image* image, Image* bankImage = nullptr);
     void createBankOfGaborFilters();
     void filter() override;
-    double getMaxInMatWithValidityMask(const cv::Mat& mat, const cv::Mat& validityMask);
-    double getMinInMatWithValidityMask(const cv::Mat& mat, const cv::Mat& validityMask);
+	void filterBlocks(const cv::Mat& sourceImage, cv::Mat& processedImage, const cv::Rect& blocks, int kernelId);
+	void filterBlocksDirect(const cv::Mat& sourceImage, cv::Mat& processedImage, const cv::Rect& pixels, const cv::Mat& gaborKernel);
+	void convolveSpectral(const cv::Mat& sourceImage, const cv::Rect& pixels, int kernelId, const cv::Mat& gaborKernel, cv::Mat& filteredBlocks);
+	int getKernelId(unsigned char orientationBin, unsigned char period);
+	cv::Mat getKernel(int kernelId);
+	static vector<KernelRun> groupBlocksByKernel(const BlockGrid<int>& kernelIds);
+    double getMaxInMatAtBlocks(const cv::Mat& mat, const vector<cv::Point>& blocks);
+    double getMinInMatAtBlocks(const cv::Mat& mat, const vector<cv::Point>& blocks);
 	int getClosestValueIndex(double value, const vector<double>& vector);
+	static int getMaxKernelRadius();
+	static void fillGaborKernel(cv::Mat& kernel, double sigma, double theta, double lambda, double gamma, double psi);
 };
 
 
@@ -0,0 +1,30 @@
+#include "GaborKernelCache.h"
+#include "GaborFilter.h"
+
+
+std::map<GaborKernelCache::KernelKey, cv::Mat> GaborKernelCache::kernels;
+std::mutex GaborKernelCache::kernelsMutex;
+
+
+//kernels are created under the lock, they are small and created only once per key
+cv::Mat GaborKernelCache::get(int size, double sigma, double theta, double lambda, double gamma, double psi, int type)
+{
+	KernelKey key(size, sigma, theta, lambda, gamma, psi, type);
+	std::lock_guard<std::mutex> lock(kernelsMutex);
+
+	auto cached = kernels.find(key);
+	if (cached != kernels.end())
+		return cached->second;
+
+	cv::Mat kernel(size, size, type);
+	GaborFilter::fillGaborKernel(kernel, sigma, theta, lambda, gamma, psi);
+	kernels.emplace(key, kernel);
+	return kernel;
+}
+
+
+size_t GaborKernelCache::size()
+{
+	std::lock_guard<std::mutex> lock(kernelsMutex);
+	return kernels.size();
+}
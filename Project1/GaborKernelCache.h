@@ -0,0 +1,24 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+/**
+ * process-wide cache of gabor kernels, safe to use from more workers at once
+ * returned kernels share data with the cache and must not be written
+ */
+class GaborKernelCache
+{
+private:
+	//size, sigma, theta, lambda, gamma, psi, type
+	typedef std::tuple<int, double, double, double, double, double, int> KernelKey;
+
+	static std::map<KernelKey, cv::Mat> kernels;
+	static std::mutex kernelsMutex;
+
+public:
+	static cv::Mat get(int size, double sigma, double theta, double lambda, double gamma, double psi, int type);
+	static size_t size();
+};
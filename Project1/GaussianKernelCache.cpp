@@ -0,0 +1,81 @@
+#include "GaussianKernelCache.h"
+#include "Filter.h"
+
+
+std::map<GaussianKernelCache::KernelKey, cv::Mat> GaussianKernelCache::kernels;
+std::mutex GaussianKernelCache::kernelsMutex;
+
+
+cv::Mat GaussianKernelCache::create(const KernelKey& key)
+{
+	int rows = std::get<1>(key);
+	int cols = std::get<2>(key);
+	double sigmaX = std::get<3>(key);
+	double sigmaY = std::get<4>(key);
+	int type = std::get<5>(key);
+
+	switch (std::get<0>(key))
+	{
+	case KERNEL_2D:
+	{
+		//outer product of column kernel for y and row kernel for x
+		cv::Mat gaussX = cv::getGaussianKernel(cols, sigmaX, CV_64F);
+		cv::Mat gaussY = cv::getGaussianKernel(rows, sigmaY, CV_64F);
+		cv::Mat kernel = gaussX * gaussY.t();
+		kernel.convertTo(kernel, type);
+		return kernel;
+	}
+	case KERNEL_BLOCK:
+		return Filter::getBlockGaussianKernel(rows, sigmaX, std::get<6>(key));
+	default:
+		return cv::getGaussianKernel(rows, sigmaX, type);
+	}
+}
+
+
+/**
+ * kernels are created outside of the lock, block kernel is built from cached 1D kernel
+ * when two workers create the same kernel, the first one inserted is kept
+ */
+cv::Mat GaussianKernelCache::get(const KernelKey& key)
+{
+	{
+		std::lock_guard<std::mutex> lock(kernelsMutex);
+
+		auto cached = kernels.find(key);
+		if (cached != kernels.end())
+			return cached->second;
+	}
+
+	cv::Mat kernel = create(key);
+
+	std::lock_guard<std::mutex> lock(kernelsMutex);
+	return kernels.emplace(key, kernel).first->second;
+}
+
+
+//column kernel, same as cv::getGaussianKernel
+cv::Mat GaussianKernelCache::get1D(int size, double sigma, int type)
+{
+	return get(KernelKey(KERNEL_1D, size, 1, sigma, sigma, type, 0));
+}
+
+
+cv::Mat GaussianKernelCache::get2D(int rows, int cols, double sigmaX, double sigmaY, int type)
+{
+	return get(KernelKey(KERNEL_2D, rows, cols, sigmaX, sigmaY, type, 0));
+}
+
+
+//kernel between blocks of Filter::smoothenBlockField
+cv::Mat GaussianKernelCache::getBlock(int kernelSize, double sigma, int blockSize)
+{
+	return get(KernelKey(KERNEL_BLOCK, kernelSize, 1, sigma, sigma, CV_64F, blockSize));
+}
+
+
+size_t GaussianKernelCache::size()
+{
+	std::lock_guard<std::mutex> lock(kernelsMutex);
+	return kernels.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+/**
+ * process-wide cache of gaussian kernels, safe to use from more workers at once
+ * returned kernels share data with the cache and must not be written
+ */
+class GaussianKernelCache
+{
+private:
+	//kind, rows, cols, sigma x, sigma y, type, block size
+	typedef std::tuple<int, int, int, double, double, int, int> KernelKey;
+
+	enum KernelKind
+	{
+		KERNEL_1D,
+		KERNEL_2D,
+		KERNEL_BLOCK
+	};
+
+	static std::map<KernelKey, cv::Mat> kernels;
+	static std::mutex kernelsMutex;
+
+	static cv::Mat create(const KernelKey& key);
+	static cv::Mat get(const KernelKey& key);
+
+public:
+	static cv::Mat get1D(int size, double sigma, int type);
+	static cv::Mat get2D(int rows, int cols, double sigmaX, double sigmaY, int type);
+	static cv::Mat getBlock(int kernelSize, double sigma, int blockSize);
+	static size_t size();
+};
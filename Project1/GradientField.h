@@ -0,0 +1,13 @@
+#pragma once
+#include <opencv2/core/mat.hpp>
+
+//gradient data of processed image kept for stages working with other block sizes
+typedef struct GradientField {
+	//integral image of structure tensor components (gxx, gyy, gxy),
+	//CV_64FC3 with one more row and column than the image
+	cv::Mat tensorIntegral;
+
+	//pixels between neighboring integral samples, block size when integral is built from block tensors
+	//of tiled image, sums of other rectangles are then interpolated between block corners
+	int step = 1;
+}GradientField;
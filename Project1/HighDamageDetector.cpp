@@ -13,83 +13,74 @@ void HighDamageDetector::findHeavilyDamagedAreas(Image* image)
 	cv::Mat qualityMap = image->getQualityMap();
 	cv::Mat backgroundMask = image->getBackgroundMask();
 
+	//intermediate maps are kept in worker workspace
+	cv::Mat qualityCategoryMap = image->acquireBuffer(QUALITY_CATEGORY_MAP, qualityMap.size(), CV_8U);
+	cv::Mat areasClasificationMap = image->acquireBuffer(CLASSIFICATION_MAP, qualityMap.size(), CV_8U);
+
 	//divide quality map to 3 quality categories
-	cv::Mat qualityCategoryMap = divideQualityMapToCategories(qualityMap, backgroundMask);
+	divideQualityMapToCategories(qualityMap, image->getForegroundBlocks(), qualityCategoryMap);
 
-	cv::Mat areasClasificationMap = findContinuousAreasInQualityMap(qualityCategoryMap, backgroundMask);
+	findContinuousAreasInQualityMap(qualityCategoryMap, backgroundMask, areasClasificationMap);
 
 	vector<ImageArea> damagedAreas;
 	cv::Mat identifiedAreas = identifyAreas(areasClasificationMap, backgroundMask, &damagedAreas);
 
-	image->setHighlyDamagedAreas(damagedAreas);
+	image->setHighlyDamagedAreas(std::move(damagedAreas));
 	image->setHighlyDamagedAreasPreview(identifiedAreas);
 }
 
 
-cv::Mat HighDamageDetector::divideQualityMapToCategories(cv::Mat qualityMap, const cv::Mat& backgroundMask)
+cv::Mat HighDamageDetector::divideQualityMapToCategories(cv::Mat qualityMap, const ForegroundBlockIndex& foregroundBlocks,
+	cv::Mat qualityCategoryMapOut)
 {
-	cv::Mat qualityCategoryMap = cv::Mat::zeros(qualityMap.size(), CV_8U);
-
-	//divide image blocks to low damaged, damaged and OK
-	for (int blockX = 0; blockX < qualityMap.cols; blockX++) {
-		for (int blockY = 0; blockY < qualityMap.rows; blockY++) {
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
-				continue;
-			}
-
-			if (qualityMap.at<double>(blockY, blockX) < 0.62) {
-				qualityCategoryMap.at<unsigned char>(blockY, blockX) = LOW_DAMAGE;
-			}
+	BlockGrid<unsigned char> qualityCategoryMap(qualityCategoryMapOut);
+	qualityCategoryMap.fill(0);
+	BlockGrid<double> quality(qualityMap);
+
+	//divide foreground blocks to low damaged, damaged and OK
+	for (const cv::Point& block : foregroundBlocks.getBlocks()) {
+		if (quality(block) < 0.62) {
+			qualityCategoryMap(block) = LOW_DAMAGE;
+		}
 
-			if (qualityMap.at<double>(blockY, blockX) < 0.44) {
-				qualityCategoryMap.at<unsigned char>(blockY, blockX) = DAMAGED;
-			}
+		if (quality(block) < 0.44) {
+			qualityCategoryMap(block) = DAMAGED;
 		}
 	}
 
-	return qualityCategoryMap;
+	return qualityCategoryMap.getMat();
 }
 
 
-cv::Mat HighDamageDetector::findContinuousAreasInQualityMap(cv::Mat qualityCategoryMap, const cv::Mat backgroundMask)
+cv::Mat HighDamageDetector::findContinuousAreasInQualityMap(cv::Mat qualityCategoryMap, const cv::Mat backgroundMask,
+	cv::Mat classificationMapOut)
 {
-	cv::Mat classificationMap = cv::Mat::zeros(qualityCategoryMap.size(), CV_8U);
+	BlockGrid<unsigned char> classificationMap(classificationMapOut);
+	classificationMap.fill(0);
+	BlockGrid<unsigned char> categories(qualityCategoryMap);
 
-	for (int blockX = 0; blockX < qualityCategoryMap.cols; blockX++)
+	for (int blockY = 0; blockY < categories.getHeight(); blockY++)
 	{
-		for (int blockY = 0; blockY < qualityCategoryMap.rows; blockY++) {
-			int damagedInNeigh = 0;
-			int lowDamagedInNeigh = 0;
-
+		for (int blockX = 0; blockX < categories.getWidth(); blockX++) {
 			//how many neighborhood blocks are damaged
-			for (int u = -1; u <= 1; u++) {
-				for (int v = -1; v <= 1; v++) {
-					if (Image::isElementInMatSizeRange(blockX + u, blockY + v, qualityCategoryMap)) {
-						if ((int)qualityCategoryMap.at<unsigned char>(blockY + v, blockX + u) == LOW_DAMAGE) {
-							lowDamagedInNeigh++;
-						}
-						if ((int)qualityCategoryMap.at<unsigned char>(blockY + v, blockX + u) == DAMAGED) {
-							damagedInNeigh++;
-						}
-					}
-				}
-			}
+			int damagedInNeigh = categories.countInNeighborhood(blockX, blockY, DAMAGED);
+			int lowDamagedInNeigh = categories.countInNeighborhood(blockX, blockY, LOW_DAMAGE);
 
 			double neighDamageIndex = damagedInNeigh + 0.6 * lowDamagedInNeigh;
 
 			if (neighDamageIndex > 4)
 			{
-				classificationMap.at<unsigned char>(blockY, blockX) = BORDER_BLOCK;
+				classificationMap(blockX, blockY) = BORDER_BLOCK;
 			}
 
 			if (neighDamageIndex > 7)
 			{
-				classificationMap.at<unsigned char>(blockY, blockX) = INNER_BLOCK;
+				classificationMap(blockX, blockY) = INNER_BLOCK;
 			}
 		}
 	}
 
-	return classificationMap;
+	return classificationMap.getMat();
 }
 
 
@@ -115,15 +106,16 @@ cv::Mat HighDamageDetector::identifyAreas(cv::Mat areasClasificationMap, cv::Mat
 
 int HighDamageDetector::convertClassificationValueToExt(cv::Mat* identifiedAreas) {
 	int numberOfLowerDamageAreas = 0;
+	BlockGrid<int> areas(*identifiedAreas);
 
-	for (int blockX = 0; blockX < identifiedAreas->cols; blockX++) {
-		for (int blockY = 0; blockY < identifiedAreas->rows; blockY++) {
-			if (identifiedAreas->at<int>(blockY, blockX) == BORDER_BLOCK) {
-				identifiedAreas->at<int>(blockY, blockX) = LOW_DAMAGE_EXT;
+	for (int blockY = 0; blockY < areas.getHeight(); blockY++) {
+		for (int blockX = 0; blockX < areas.getWidth(); blockX++) {
+			if (areas(blockX, blockY) == BORDER_BLOCK) {
+				areas(blockX, blockY) = LOW_DAMAGE_EXT;
 				numberOfLowerDamageAreas++;
 			}
-			if (identifiedAreas->at<int>(blockY, blockX) == INNER_BLOCK) {
-				identifiedAreas->at<int>(blockY, blockX) = DAMAGED_EXT;
+			if (areas(blockX, blockY) == INNER_BLOCK) {
+				areas(blockX, blockY) = DAMAGED_EXT;
 			}
 		}
 	}
@@ -137,14 +129,18 @@ void HighDamageDetector::removeLowerDamageAreasNotConnectedToHiglyDamagedArea(cv
 {
 	cv::Mat identifiedAreasCopy;
 	identifiedAreas->copyTo(identifiedAreasCopy);
-
-	for (int blockX = 0; blockX < identifiedAreasCopy.cols; blockX++) {
-		for (int blockY = 0; blockY < identifiedAreasCopy.rows; blockY++) {
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
+	BlockGrid<int> areasCopy(identifiedAreasCopy);
+	BlockGrid<int> areas(*identifiedAreas);
+	BlockGrid<unsigned char> background(backgroundMask);
+
+	//every connected low damage area is removed or kept as a whole, visiting order does not matter
+	for (int blockY = 0; blockY < areasCopy.getHeight(); blockY++) {
+		for (int blockX = 0; blockX < areasCopy.getWidth(); blockX++) {
+			if (background(blockX, blockY) == BACKGROUND) {
 				continue;
 			}
 
-			if (identifiedAreasCopy.at<int>(blockY, blockX) == LOW_DAMAGE_EXT) {
+			if (areasCopy(blockX, blockY) == LOW_DAMAGE_EXT) {
 				vector<cv::Point> allNeighboringLowDamage;
 				bool neighboringHighDamageBlock = FloodFill::searchFloodFillStep(blockX, blockY, &identifiedAreasCopy, LOW_DAMAGE_EXT,
 					0, DAMAGED_EXT, &allNeighboringLowDamage);
@@ -152,7 +148,7 @@ void HighDamageDetector::removeLowerDamageAreasNotConnectedToHiglyDamagedArea(cv
 				//remove low damage blocks, that have no connection to a highly damaged block
 				if (!neighboringHighDamageBlock) {
 					for (int i = 0; i < allNeighboringLowDamage.size(); i++) {
-						identifiedAreas->at<int>(allNeighboringLowDamage.at(i)) = 0;
+						areas(allNeighboringLowDamage.at(i)) = 0;
 						*numberOfLowerDamageAreas = *numberOfLowerDamageAreas - 1;
 					}
 				}
@@ -165,19 +161,22 @@ void HighDamageDetector::removeLowerDamageAreasNotConnectedToHiglyDamagedArea(cv
 vector<ImageArea> HighDamageDetector::fillHighlyDamagedAreas(cv::Mat* identifiedAreas, const cv::Mat& backgroundMask, int* areaIndex)
 {
 	vector<ImageArea> damagedAreas;
+	BlockGrid<int> areas(*identifiedAreas);
+	BlockGrid<unsigned char> background(backgroundMask);
 
-	for (int blockX = 0; blockX < identifiedAreas->cols; blockX++) {
-		for (int blockY = 0; blockY < identifiedAreas->rows; blockY++) {
+	//areas are numbered in visiting order, blocks are visited column by column
+	for (int blockX = 0; blockX < areas.getWidth(); blockX++) {
+		for (int blockY = 0; blockY < areas.getHeight(); blockY++) {
 			//skip background
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
+			if (background(blockX, blockY) == BACKGROUND) {
 				continue;
 			}
 
 			//fill damaged area
-			if (identifiedAreas->at<int>(blockY, blockX) == DAMAGED_EXT) {
+			if (areas(blockX, blockY) == DAMAGED_EXT) {
 				vector<cv::Point> areaBlocks;
 				FloodFill::floodFillStep(blockX, blockY, identifiedAreas, DAMAGED_EXT, *areaIndex, &areaBlocks);
-				damagedAreas.push_back(ImageArea(areaBlocks, DAMAGED));
+				damagedAreas.push_back(ImageArea(std::move(areaBlocks), DAMAGED, *areaIndex));
 				*areaIndex = *areaIndex + 1;
 			}
 		}
@@ -190,6 +189,8 @@ vector<ImageArea> HighDamageDetector::fillHighlyDamagedAreas(cv::Mat* identified
 void HighDamageDetector::attachLowerDamageAreas(cv::Mat* identifiedAreas, cv::Mat backgroundMask, int numberOfLowerDamageAreas, vector<ImageArea>* damagedAreas)
 {
 	cv::Mat processedDamagedBlocks = cv::Mat::zeros(identifiedAreas->size(), CV_32S);
+	BlockGrid<int> processedBlocks(processedDamagedBlocks);
+	BlockGrid<unsigned char> background(backgroundMask);
 
 	cv::Mat identifiedAreasBeforeIteration;
 	cv::Mat identifiedAreasAfterIteration;
@@ -197,21 +198,23 @@ void HighDamageDetector::attachLowerDamageAreas(cv::Mat* identifiedAreas, cv::Ma
 	identifiedAreas->copyTo(identifiedAreasAfterIteration);
 
 	while (numberOfLowerDamageAreas > 0) {
+		BlockGrid<int> areasBeforeIteration(identifiedAreasBeforeIteration);
 
-		for (int blockX = 0; blockX < identifiedAreas->cols; blockX++)
+		//areas compete for low damage blocks in visiting order, blocks are visited column by column
+		for (int blockX = 0; blockX < areasBeforeIteration.getWidth(); blockX++)
 		{
-			for (int blockY = 0; blockY < identifiedAreas->rows; blockY++)
+			for (int blockY = 0; blockY < areasBeforeIteration.getHeight(); blockY++)
 			{
-				if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
+				if (background(blockX, blockY) == BACKGROUND)
 					continue;
-				if (processedDamagedBlocks.at<int>(blockY, blockX) == CHECKED)
+				if (processedBlocks(blockX, blockY) == CHECKED)
 					continue;
 
 				//high damage area
-				if (identifiedAreasBeforeIteration.at<int>(blockY, blockX) != 0 &&
-					identifiedAreasBeforeIteration.at<int>(blockY, blockX) != LOW_DAMAGE_EXT)
+				if (areasBeforeIteration(blockX, blockY) != 0 &&
+					areasBeforeIteration(blockX, blockY) != LOW_DAMAGE_EXT)
 				{
-					int areaIndex = identifiedAreasBeforeIteration.at<int>(blockY, blockX);
+					int areaIndex = areasBeforeIteration(blockX, blockY);
 
 					attachClosestLowerDamageAreaToOneArea(areaIndex, blockX, blockY, &identifiedAreasBeforeIteration, &identifiedAreasAfterIteration,
 						backgroundMask, &numberOfLowerDamageAreas, &processedDamagedBlocks, damagedAreas);
@@ -230,29 +233,34 @@ void HighDamageDetector::attachClosestLowerDamageAreaToOneArea(int areaIndex, in
 	cv::Mat* identifiedAreasAfterIteration, const cv::Mat& backgroundMask, int* numberOfLowerDamageAreas,
 	cv::Mat* processedDamagedBlocks, vector<ImageArea>* damagedAreas)
 {
-	for (int damageBlockX = blockX; damageBlockX < identifiedAreasBeforeIteration->cols; damageBlockX++)
+	BlockGrid<int> areasBefore(*identifiedAreasBeforeIteration);
+	BlockGrid<int> areasAfter(*identifiedAreasAfterIteration);
+	BlockGrid<int> processedBlocks(*processedDamagedBlocks);
+	BlockGrid<unsigned char> background(backgroundMask);
+
+	for (int damageBlockX = blockX; damageBlockX < areasBefore.getWidth(); damageBlockX++)
 	{
-		for (int damageBlockY = 0; damageBlockY < identifiedAreasBeforeIteration->rows; damageBlockY++)
+		for (int damageBlockY = 0; damageBlockY < areasBefore.getHeight(); damageBlockY++)
 		{
-			if (BackgroundSubstractor::isBackgroundBlock(damageBlockX, damageBlockY, backgroundMask))
+			if (background(damageBlockX, damageBlockY) == BACKGROUND)
 				continue;
 
 			//for each block of the current damage area
-			if (identifiedAreasBeforeIteration->at<int>(damageBlockY, damageBlockX) == areaIndex)
+			if (areasBefore(damageBlockX, damageBlockY) == areaIndex)
 			{
 				for (int maskX = -1; maskX <= 1; maskX++) {
 					for (int maskY = -1; maskY <= 1; maskY++) {
-						if (!Image::isElementInMatSizeRange(damageBlockX + maskX, damageBlockY + maskY, *identifiedAreasBeforeIteration))
+						if (!areasBefore.isInRange(damageBlockX + maskX, damageBlockY + maskY))
 							continue;
-						if (BackgroundSubstractor::isBackgroundBlock(damageBlockX + maskX, damageBlockY + maskY, backgroundMask))
+						if (background(damageBlockX + maskX, damageBlockY + maskY) == BACKGROUND)
 							continue;
 
 						//low damage block in neighborhood, but was not already connected to damaged area in this iteration 
-						if (identifiedAreasBeforeIteration->at<int>(damageBlockY + maskY, damageBlockX + maskX) == LOW_DAMAGE_EXT &&
-							!blockWasChanged(*identifiedAreasBeforeIteration, *identifiedAreasAfterIteration, damageBlockX + maskX, damageBlockY + maskY)) {
+						if (areasBefore(damageBlockX + maskX, damageBlockY + maskY) == LOW_DAMAGE_EXT &&
+							areasBefore(damageBlockX + maskX, damageBlockY + maskY) == areasAfter(damageBlockX + maskX, damageBlockY + maskY)) {
 
 							//add block to damage area in map
-							identifiedAreasAfterIteration->at<int>(damageBlockY + maskY, damageBlockX + maskX) = areaIndex;
+							areasAfter(damageBlockX + maskX, damageBlockY + maskY) = areaIndex;
 							//add block to damaged area structure either
 							damagedAreas->at(areaIndex - 1).addPoint(cv::Point(damageBlockX + maskX, damageBlockY + maskY));
 
@@ -260,21 +268,13 @@ void HighDamageDetector::attachClosestLowerDamageAreaToOneArea(int areaIndex, in
 						}
 					}
 				}
-				processedDamagedBlocks->at<int>(damageBlockY, damageBlockX) = CHECKED;
+				processedBlocks(damageBlockX, damageBlockY) = CHECKED;
 			}
 		}
 	}
 }
 
 
-bool HighDamageDetector::blockWasChanged(const cv::Mat& former, const cv::Mat& updated, int x, int y)
-{
-	if (former.at<int>(y, x) == updated.at<int>(y, x))
-		return false;
-	else
-		return true;
-}
-
 cv::Mat HighDamageDetector::drawHighDamageAreasFromPreview(Image* image)
 {
 	cv::Mat preview = image->getHighlyDamagedAreasPreview();
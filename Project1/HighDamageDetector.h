@@ -1,5 +1,6 @@
 #pragma once
 #include "Image.h"
+#include "BlockGrid.h"
 
 
 #define CHECKED 1
@@ -14,8 +15,8 @@ class HighDamageDetector
 public:
 	HighDamageDetector();
 	void findHeavilyDamagedAreas(Image* image);
-	cv::Mat divideQualityMapToCategories(cv::Mat qualityMap, const cv::Mat& backgroundMask);
-	cv::Mat findContinuousAreasInQualityMap(cv::Mat qualityCategoryMap, const cv::Mat backgroundMask);
+	cv::Mat divideQualityMapToCategories(cv::Mat qualityMap, const ForegroundBlockIndex& foregroundBlocks, cv::Mat qualityCategoryMapOut);
+	cv::Mat findContinuousAreasInQualityMap(cv::Mat qualityCategoryMap, const cv::Mat backgroundMask, cv::Mat classificationMapOut);
 	cv::Mat identifyAreas(cv::Mat areasClasificationMap, cv::Mat backgroundMask, vector<ImageArea>* damagedAreas);
 	int convertClassificationValueToExt(cv::Mat* identifiedAreas);
 	void removeLowerDamageAreasNotConnectedToHiglyDamagedArea(cv::Mat* identifiedAreas, const cv::Mat& backgroundMask,
@@ -24,7 +25,6 @@ public:
 	void attachLowerDamageAreas(cv::Mat* identifiedAreas, cv::Mat backgroundMask, int numberOfLowerDamageAreas, vector<ImageArea>* damagedAreas);
 	void attachClosestLowerDamageAreaToOneArea(int area_index, int block_x, int block_y, cv::Mat* mat, cv::Mat* identified_areas_after_iteration,
 		const cv::Mat& background_mask, int* number_of_lower_damage_areas, cv::Mat* processed_damaged_blocks, vector<ImageArea>* damagedAreas);
-	bool blockWasChanged(const cv::Mat& former, const cv::Mat& updated, int x, int y);
 
 	static cv::Mat drawHighDamageAreasFromPreview(Image* image);
 };
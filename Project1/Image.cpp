@@ -1,5 +1,7 @@
 #include "Image.h"
 #include "Filter.h"
+#include "BlockGrid.h"
+#include "FieldQuantizer.h"
 
 using namespace std;
 
@@ -10,25 +12,49 @@ Image::Image()
     processedImage = srcImg;
     blockSize = 0;
     windowWidth = 0;
+    workspace = nullptr;
 }
 
 
-Image::Image(cv::Mat srcImage)
+Image::Image(const cv::Mat& srcImage)
+    : Image(srcImage, getDefaultBlockSize(srcImage.cols))
+{
+}
+
+
+//odd block size following image width, image is cropped to its multiple
+int Image::getDefaultBlockSize(int imageWidth)
+{
+    int blockSize = imageWidth / 34;
+    return (blockSize % 2 == 0) ? blockSize + 1 : blockSize;
+}
+
+
+//block size given by caller, used for tiles that have to share block grid of whole image
+Image::Image(const cv::Mat& srcImage, int blockSize)
 {
     //determine size of blocksize and windowWidth for field and frequency map
-    blockSize = srcImage.cols / 34;
-    (blockSize % 2 == 0) ? blockSize++ : blockSize;
-    windowWidth = 2 * blockSize;
+    this->blockSize = blockSize;
+    (this->blockSize % 2 == 0) ? this->blockSize++ : this->blockSize;
+    windowWidth = 2 * this->blockSize;
+    workspace = nullptr;
 
     //crop processedImage to multiple of blocksize of field field
     cv::Rect rectCrop(
         0,
         0,
-        srcImage.cols / blockSize * blockSize,
-        srcImage.rows / blockSize * blockSize);
+        srcImage.cols / this->blockSize * this->blockSize,
+        srcImage.rows / this->blockSize * this->blockSize);
     cv::Mat croppedImage(srcImage, rectCrop);
-	croppedImage.convertTo(this->image, CV_8U);
-    croppedImage.convertTo(this->processedImage, CV_8U);
+
+    //source pixels are never written, 8-bit source is only referenced
+    if (croppedImage.type() == CV_8U)
+        this->image = croppedImage;
+    else
+        croppedImage.convertTo(this->image, CV_8U);
+
+    //stages replace processed image instead of writing into it, so both can share pixels
+    this->processedImage = this->image;
 }
 
 
@@ -47,8 +73,8 @@ bool Image::setSrcImage(cv::Mat image)
             image.cols / this->blockSize * this->blockSize,
             image.rows / this->blockSize * this->blockSize);
         cv::Mat croppedImage(image, rectCrop);
-        croppedImage.copyTo(this->image);
-		croppedImage.copyTo(this->processedImage);
+        this->image = croppedImage.clone();
+		this->processedImage = this->image;
     }
     catch (...)
     {
@@ -58,11 +84,12 @@ bool Image::setSrcImage(cv::Mat image)
 }
 
 
-bool Image::setProcessedImage(cv::Mat image)
+bool Image::setProcessedImage(const cv::Mat& image)
 {
     try
     {
-        image.copyTo(this->processedImage);
+        //takes over given pixels, caller must not write into them later
+        this->processedImage = image;
     }
     catch (...)
     {
@@ -77,42 +104,71 @@ void Image::setBlockSize(int blockSize)
     this->blockSize = blockSize;
 }
 
-void Image::setBackgroundMask(cv::Mat bMask)
+void Image::setBackgroundMask(const cv::Mat& bMask)
 {
     this->blockBackgroundMask = bMask;
 }
 
-void Image::setQualityMap(cv::Mat qMap)
+void Image::setForegroundBlocks(ForegroundBlockIndex index)
+{
+	this->foregroundBlocks = std::move(index);
+}
+
+void Image::setBlockStatistics(BlockStatistics statistics)
+{
+	this->blockStatistics = std::move(statistics);
+}
+
+//matrices usually live in workspace, they are valid until processed image is replaced
+void Image::setGradientField(const GradientField& gradients)
+{
+	this->gradientField = gradients;
+}
+
+void Image::setOrientedSignatures(OrientedSignatures signatures)
+{
+	this->orientedSignatures = std::move(signatures);
+}
+
+void Image::setQualityMap(const cv::Mat& qMap)
 {
 	this->qualityMap = qMap;
 }
 
 void Image::setHighlyDamagedAreas(vector<ImageArea> areas)
 {
-	this->higlyDamagedAreas = areas;
+	this->higlyDamagedAreas = std::move(areas);
 }
 
-void Image::setSingularityMap(cv::Mat map)
+void Image::setSingularityMap(const cv::Mat& map)
 {
 	this->singularityMap = map;
 }
 
-void Image::setHighlyDamagedAreasPreview(cv::Mat map)
+void Image::setHighlyDamagedAreasPreview(const cv::Mat& map)
 {
 	this->highlyDamagedAreasPreview = map;
 }
 
-void Image::setFrequencyField(cv::Mat fField)
+void Image::setWorkspace(PipelineWorkspace* workspace)
+{
+	this->workspace = workspace;
+}
+
+//quantized copies are kept in sync, they are block sized and cheap to rebuild
+void Image::setFrequencyField(const cv::Mat& fField)
 {
     this->frequencyField = fField;
+    this->periodField = fField.empty() ? cv::Mat() : FieldQuantizer::quantizePeriodField(fField);
 }
 
-void Image::setOrientationField(cv::Mat oField)
+void Image::setOrientationField(const cv::Mat& oField)
 {
     this->orientationField = oField;
+    this->quantizedOrientationField = oField.empty() ? cv::Mat() : FieldQuantizer::quantizeOrientationField(oField);
 }
 
-void Image::setNonSmoothedOrientationField(cv::Mat oField) {
+void Image::setNonSmoothedOrientationField(const cv::Mat& oField) {
 	this->nonSmoothedOrientationField = oField;
 }
 
@@ -122,12 +178,12 @@ void Image::setWindowWidth(int windowWidth)
 }
 
 
-cv::Mat Image::getProcessedImage()
+const cv::Mat& Image::getProcessedImage()
 {
     return this->processedImage;
 }
 
-cv::Mat Image::getImage()
+const cv::Mat& Image::getImage()
 {
 	return this->image;
 }
@@ -137,47 +193,97 @@ cv::Size Image::getSize()
     return this->processedImage.size();
 }
 
-cv::Mat Image::getBackgroundMask()
+const cv::Mat& Image::getBackgroundMask()
 {
     return this->blockBackgroundMask;
 }
 
-cv::Mat Image::getQualityMap()
+const ForegroundBlockIndex& Image::getForegroundBlocks()
+{
+	return this->foregroundBlocks;
+}
+
+const BlockStatistics& Image::getBlockStatistics()
+{
+	return this->blockStatistics;
+}
+
+const GradientField& Image::getGradientField()
+{
+	return this->gradientField;
+}
+
+const OrientedSignatures& Image::getOrientedSignatures()
+{
+	return this->orientedSignatures;
+}
+
+const cv::Mat& Image::getQualityMap()
 {
 	return this->qualityMap;
 }
 
-vector<ImageArea> Image::getHighlyDamagedAreas()
+const vector<ImageArea>& Image::getHighlyDamagedAreas()
 {
 	return this->higlyDamagedAreas;
 }
 
-cv::Mat Image::getSingularityMap()
+//only for stages that change state of already found areas
+vector<ImageArea>& Image::getHighlyDamagedAreasForUpdate()
+{
+	return this->higlyDamagedAreas;
+}
+
+const cv::Mat& Image::getSingularityMap()
 {
 	return this->singularityMap;
 }
 
-cv::Mat Image::getHighlyDamagedAreasPreview()
+const cv::Mat& Image::getHighlyDamagedAreasPreview()
 {
 	return this->highlyDamagedAreasPreview;
 }
 
+PipelineWorkspace* Image::getWorkspace()
+{
+	return this->workspace;
+}
+
+//temporary buffer from worker workspace, newly allocated when image is processed without one
+cv::Mat Image::acquireBuffer(WorkspaceBuffer buffer, const cv::Size& size, int type)
+{
+	if (this->workspace == nullptr)
+		return cv::Mat(size, type);
+
+	return this->workspace->acquire(buffer, size, type);
+}
+
 int Image::getBlockSize()
 {
     return this->blockSize;
 }
 
-cv::Mat Image::getFrequencyField()
+const cv::Mat& Image::getFrequencyField()
 {
     return this->frequencyField;
 }
 
-cv::Mat Image::getOrientationField()
+const cv::Mat& Image::getQuantizedOrientationField()
+{
+	return this->quantizedOrientationField;
+}
+
+const cv::Mat& Image::getPeriodField()
+{
+	return this->periodField;
+}
+
+const cv::Mat& Image::getOrientationField()
 {
     return this->orientationField;
 }
 
-cv::Mat Image::getNonSmoothedOrientationField() {
+const cv::Mat& Image::getNonSmoothedOrientationField() {
 	return this->nonSmoothedOrientationField;
 }
 
@@ -214,28 +320,40 @@ void Image::getPixelBlock(int pixelX, int pixelY, int blockSize, int* pixelBlock
 }
 
 
-cv::Mat Image::extendBlocksToFullSizeImage(cv::Mat blocks, int blockSize, cv::Size imageSize)
+template<typename T>
+static void extendBlocks(const cv::Mat& blocks, int blockSize, cv::Mat& finalImage)
 {
-	cv::Mat finalImage(imageSize, blocks.type());
+	BlockGrid<T> blockValues(blocks);
 
-    for(int i = 0; i < finalImage.cols; i++)
-    {
-		for (int j = 0; j < finalImage.rows; j++)
+	for (int j = 0; j < finalImage.rows; j++)
+	{
+		T* pixelRow = finalImage.ptr<T>(j);
+		const T* blockRow = blockValues.row(j / blockSize);
+
+		for (int i = 0; i < finalImage.cols; i++)
 		{
-			switch(blocks.type())
-			{
-			case CV_8U:
-				finalImage.at<unsigned char>(j, i) = blocks.at<unsigned char>(j / blockSize, i / blockSize);
-				break;
-			case CV_64F:
-				finalImage.at<double>(j, i) = blocks.at<double>(j / blockSize, i / blockSize);
-				break;
-			case CV_32S:
-				finalImage.at<int>(j, i) = blocks.at<int>(j / blockSize, i / blockSize);
-				break;
-			}
+			pixelRow[i] = blockRow[i / blockSize];
 		}
-    }
+	}
+}
+
+
+cv::Mat Image::extendBlocksToFullSizeImage(cv::Mat blocks, int blockSize, cv::Size imageSize)
+{
+	cv::Mat finalImage(imageSize, blocks.type());
+
+	switch(blocks.type())
+	{
+	case CV_8U:
+		extendBlocks<unsigned char>(blocks, blockSize, finalImage);
+		break;
+	case CV_64F:
+		extendBlocks<double>(blocks, blockSize, finalImage);
+		break;
+	case CV_32S:
+		extendBlocks<int>(blocks, blockSize, finalImage);
+		break;
+	}
 	return finalImage;
 }
 
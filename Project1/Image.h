@@ -6,9 +6,26 @@
 #include <iostream>
 #include "ImagePointState.h"
 #include "ImageArea.h"
+#include "ForegroundBlockIndex.h"
+#include "PipelineWorkspace.h"
+#include "BlockStatistics.h"
+#include "GradientField.h"
+#include "OrientedSignatures.h"
 
 #define DEBUG 1
 
+//full resolution intermediates (gradients, smoothing buffers, Gabor filtering) in float instead of double
+//per-block fields stay double
+#define SINGLE_PRECISION 0
+
+#if SINGLE_PRECISION
+typedef float pixel_t;
+#define CV_PIXEL CV_32F
+#else
+typedef double pixel_t;
+#define CV_PIXEL CV_64F
+#endif
+
 using namespace std;
 
 class Image
@@ -19,10 +36,16 @@ private:
     
 	cv::Mat orientationField;
 	cv::Mat nonSmoothedOrientationField;
+	cv::Mat quantizedOrientationField;
 	
     cv::Mat frequencyField;
+	cv::Mat periodField;
     
 	cv::Mat blockBackgroundMask;
+	ForegroundBlockIndex foregroundBlocks;
+	BlockStatistics blockStatistics;
+	GradientField gradientField;
+	OrientedSignatures orientedSignatures;
 	
 	cv::Mat singularityMap;
 	
@@ -33,40 +56,59 @@ private:
 	int blockSize;
     int windowWidth;
 
+	//not owned, shared by all images of one worker
+	PipelineWorkspace* workspace;
+
 public:
     Image();
-    Image(cv::Mat srcImage);
+    Image(const cv::Mat& srcImage);
+    Image(const cv::Mat& srcImage, int blockSize);
 
     bool setSrcImage(cv::Mat image);
-    bool setProcessedImage(cv::Mat image);
+    bool setProcessedImage(const cv::Mat& image);
     void setBlockSize(int blockSize);
     void setWindowWidth(int windowWidth);
-    void setOrientationField(cv::Mat oField);
-	void setNonSmoothedOrientationField(cv::Mat oField);
-    void setFrequencyField(cv::Mat fField);
-    void setBackgroundMask(cv::Mat bMask);
-	void setQualityMap(cv::Mat qMap);
+    void setOrientationField(const cv::Mat& oField);
+	void setNonSmoothedOrientationField(const cv::Mat& oField);
+    void setFrequencyField(const cv::Mat& fField);
+    void setBackgroundMask(const cv::Mat& bMask);
+	void setForegroundBlocks(ForegroundBlockIndex index);
+	void setBlockStatistics(BlockStatistics statistics);
+	void setGradientField(const GradientField& gradients);
+	void setOrientedSignatures(OrientedSignatures signatures);
+	void setQualityMap(const cv::Mat& qMap);
 	void setHighlyDamagedAreas(vector<ImageArea> areas);
-	void setSingularityMap(cv::Mat map);
-	void setHighlyDamagedAreasPreview(cv::Mat map);
+	void setSingularityMap(const cv::Mat& map);
+	void setHighlyDamagedAreasPreview(const cv::Mat& map);
+	void setWorkspace(PipelineWorkspace* workspace);
 
-    cv::Mat getProcessedImage();
-	cv::Mat getImage();
+    const cv::Mat& getProcessedImage();
+	const cv::Mat& getImage();
     cv::Size getSize();
     int getBlockSize();
     int getWindowWidth();
-    cv::Mat getOrientationField();
-	cv::Mat getNonSmoothedOrientationField();
-    cv::Mat getFrequencyField();
-    cv::Mat getBackgroundMask();
-	cv::Mat getQualityMap();
-	vector<ImageArea> getHighlyDamagedAreas();
-	cv::Mat getSingularityMap();
-	cv::Mat getHighlyDamagedAreasPreview();
+    const cv::Mat& getOrientationField();
+	const cv::Mat& getNonSmoothedOrientationField();
+    const cv::Mat& getFrequencyField();
+	const cv::Mat& getQuantizedOrientationField();
+	const cv::Mat& getPeriodField();
+    const cv::Mat& getBackgroundMask();
+	const ForegroundBlockIndex& getForegroundBlocks();
+	const BlockStatistics& getBlockStatistics();
+	const GradientField& getGradientField();
+	const OrientedSignatures& getOrientedSignatures();
+	const cv::Mat& getQualityMap();
+	const vector<ImageArea>& getHighlyDamagedAreas();
+	vector<ImageArea>& getHighlyDamagedAreasForUpdate();
+	const cv::Mat& getSingularityMap();
+	const cv::Mat& getHighlyDamagedAreasPreview();
+	PipelineWorkspace* getWorkspace();
+	cv::Mat acquireBuffer(WorkspaceBuffer buffer, const cv::Size& size, int type);
 
     static bool isElementInMatSizeRange(int pixelX, int pixelY, const cv::Mat& img);
     static bool isElementBorderElementOfMat(int pixelX, int pixelY, const cv::Mat& img);
     static void getPixelBlock(int pixelX, int pixelY, int blockSize, int* pixelBlockX, int* pixelBlockY);
+	static int getDefaultBlockSize(int imageWidth);
 	static cv::Mat extendBlocksToFullSizeImage(cv::Mat blocks, int blockSize, cv::Size imageSize);
 	static cv::Mat_<unsigned char> convertToUCharAndExtendToRange0_255(cv::Mat values);
 
@@ -1,85 +1,85 @@
 #include "ImageArea.h"
+#include <climits>
 
 
 ImageArea::ImageArea(vector<cv::Point> points, int pointsState)
+	: ImageArea(std::move(points), pointsState, 0)
 {
-	this->points = points;
+}
+
+ImageArea::ImageArea(vector<cv::Point> points, int pointsState, int label)
+{
+	this->points = std::move(points);
 	this->pointsState = pointsState;
+	this->label = label;
+
+	this->minX = INT_MAX;
+	this->maxX = INT_MIN;
+	this->minY = INT_MAX;
+	this->maxY = INT_MIN;
+
+	for (const cv::Point& point : this->points) {
+		includeInBounds(point);
+	}
 }
 
-vector<cv::Point> ImageArea::getPoints()
+void ImageArea::includeInBounds(const cv::Point& point)
+{
+	if (point.x < this->minX) this->minX = point.x;
+	if (point.x > this->maxX) this->maxX = point.x;
+	if (point.y < this->minY) this->minY = point.y;
+	if (point.y > this->maxY) this->maxY = point.y;
+}
+
+const vector<cv::Point>& ImageArea::getPoints() const
 {
 	return this->points;
 }
 
-int ImageArea::getPointsState()
+int ImageArea::getPointsState() const
 {
 	return this->pointsState;
 }
 
-int ImageArea::getHeight()
+int ImageArea::getLabel() const
 {
-	if (!this->getPoints().empty()) {
-		int minY = this->getPoints().at(0).y;
-		int maxY = this->getPoints().at(0).y;
-
-		for (int i = 1; i < this->getPoints().size(); i++) {
-			if (this->getPoints().at(i).y < minY) {
-				minY = this->getPoints().at(i).y;
-			}
-			if (this->getPoints().at(i).y > maxY) {
-				maxY = this->getPoints().at(i).y;
-			}
-		}
-
-		return maxY - minY;
-	}
-	else {
+	return this->label;
+}
+
+//difference of extreme block coordinates, single block area has zero height
+int ImageArea::getHeight() const
+{
+	if (this->points.empty())
 		return 0;
-	}
+
+	return this->maxY - this->minY;
 }
 
-int ImageArea::getWidth()
+int ImageArea::getWidth() const
 {
-	if (!this->getPoints().empty())
-	{
-		int minX = this->getPoints().at(0).x;
-		int maxX = this->getPoints().at(0).x;
-
-		for (int i = 1; i < this->getPoints().size(); i++)
-		{
-			if (this->getPoints().at(i).x < minX)
-			{
-				minX = this->getPoints().at(i).x;
-			}
-			if (this->getPoints().at(i).x > maxX)
-			{
-				maxX = this->getPoints().at(i).x;
-			}
-		}
-
-		return maxX - minX;
-	}
-	else
-	{
+	if (this->points.empty())
 		return 0;
-	}
+
+	return this->maxX - this->minX;
 }
 
-int ImageArea::getPointsNumber()
+int ImageArea::getMinDimension() const
 {
-	return this->getPoints().size();
+	return (getHeight() < getWidth()) ? getHeight() : getWidth();
 }
 
-void ImageArea::addPoint(cv::Point point)
+int ImageArea::getPointsNumber() const
+{
+	return static_cast<int>(this->points.size());
+}
+
+void ImageArea::addPoint(const cv::Point& point)
 {
 	this->points.push_back(point);
+	includeInBounds(point);
 }
 
 void ImageArea::setPointsState(int state)
 {
 	this->pointsState = state;
 }
-
-
-
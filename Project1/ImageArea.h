@@ -3,21 +3,35 @@
 
 using namespace std;
 
+/**
+ * connected area of blocks, label is the area value in label image of high damage detection
+ * geometry is updated with every added point, so it is never recomputed from points
+ */
 class ImageArea {
 private:
 	vector<cv::Point> points;
 	int pointsState;
+	int label;
+
+	int minX;
+	int maxX;
+	int minY;
+	int maxY;
+
+	void includeInBounds(const cv::Point& point);
 
 public:
 	ImageArea(vector<cv::Point> points, int pointsState);
+	ImageArea(vector<cv::Point> points, int pointsState, int label);
 
-	vector<cv::Point> getPoints();
-	int getPointsState();
-	int getHeight();
-	int getWidth();
-	int getPointsNumber();
+	const vector<cv::Point>& getPoints() const;
+	int getPointsState() const;
+	int getLabel() const;
+	int getHeight() const;
+	int getWidth() const;
+	int getMinDimension() const;
+	int getPointsNumber() const;
 
-	void addPoint(cv::Point point);
+	void addPoint(const cv::Point& point);
 	void setPointsState(int state);
 }; 
-
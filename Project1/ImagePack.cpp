@@ -0,0 +1,129 @@
+#include "ImagePack.h"
+#include <opencv2/imgcodecs.hpp>
+#include <fstream>
+#include <climits>
+
+
+ImagePack::ImagePack()
+{
+	this->entries = nullptr;
+	this->imageCount = 0;
+}
+
+
+bool ImagePack::open(const std::string& path)
+{
+	this->entries = nullptr;
+	this->imageCount = 0;
+
+	if (!this->file.open(path) || this->file.getSize() < sizeof(ImagePackHeader))
+		return false;
+
+	const ImagePackHeader* header = reinterpret_cast<const ImagePackHeader*>(this->file.getData());
+	if (header->magic != IMAGE_PACK_MAGIC || header->version != IMAGE_PACK_VERSION)
+		return false;
+
+	size_t indexEnd = sizeof(ImagePackHeader) + static_cast<size_t>(header->imageCount) * sizeof(ImagePackEntry);
+	if (indexEnd > this->file.getSize())
+		return false;
+
+	const ImagePackEntry* index = reinterpret_cast<const ImagePackEntry*>(this->file.getData() + sizeof(ImagePackHeader));
+
+	//pixels of every image have to be inside of file, checked without overflow
+	//dimensions are used as int by cv::Mat
+	uint64_t fileSize = this->file.getSize();
+	for (uint32_t i = 0; i < header->imageCount; i++)
+	{
+		if (index[i].width > INT_MAX || index[i].height > INT_MAX)
+			return false;
+
+		uint64_t pixels = static_cast<uint64_t>(index[i].width) * index[i].height;
+		if (index[i].offset < indexEnd || index[i].offset > fileSize || pixels > fileSize - index[i].offset)
+			return false;
+	}
+
+	//images are read one after another
+	this->file.adviseSequential();
+
+	this->entries = index;
+	this->imageCount = header->imageCount;
+	return true;
+}
+
+
+int ImagePack::getImageCount() const
+{
+	return static_cast<int>(this->imageCount);
+}
+
+
+/**
+ * header over mapped pixels, valid while the pack is open
+ * mapping is read-only, pipeline never writes into source pixels
+ */
+cv::Mat ImagePack::getImage(int index) const
+{
+	const ImagePackEntry& entry = this->entries[index];
+	void* pixels = const_cast<unsigned char*>(this->file.getData() + entry.offset);
+
+	return cv::Mat(static_cast<int>(entry.height), static_cast<int>(entry.width), CV_8U, pixels);
+}
+
+
+//starts reading pixels of image that will be processed next
+void ImagePack::prefetch(int index) const
+{
+	if (index < 0 || index >= getImageCount())
+		return;
+
+	const ImagePackEntry& entry = this->entries[index];
+	this->file.prefetch(static_cast<size_t>(entry.offset), static_cast<size_t>(entry.width) * entry.height);
+}
+
+
+/**
+ * packer, images are decoded one at a time so any number of them can be packed
+ * index space is reserved for all paths, images that cannot be read are skipped
+ */
+bool ImagePack::pack(const std::string& path, const std::vector<std::string>& imagePaths)
+{
+	std::ofstream output(path, std::ios::binary | std::ios::trunc);
+	if (!output)
+		return false;
+
+	ImagePackHeader header = { IMAGE_PACK_MAGIC, IMAGE_PACK_VERSION, 0, 0 };
+	std::vector<ImagePackEntry> index(imagePaths.size());
+	const char padding[IMAGE_PACK_ALIGNMENT] = { 0 };
+
+	//placeholders, rewritten when all images are known
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ImagePackEntry));
+	uint64_t offset = sizeof(ImagePackHeader) + index.size() * sizeof(ImagePackEntry);
+
+	for (const std::string& imagePath : imagePaths)
+	{
+		cv::Mat image = cv::imread(imagePath, cv::IMREAD_GRAYSCALE);
+		if (image.empty())
+			continue;
+
+		uint64_t alignedOffset = (offset + IMAGE_PACK_ALIGNMENT - 1) / IMAGE_PACK_ALIGNMENT * IMAGE_PACK_ALIGNMENT;
+		output.write(padding, static_cast<std::streamsize>(alignedOffset - offset));
+
+		ImagePackEntry& entry = index[header.imageCount++];
+		entry.offset = alignedOffset;
+		entry.width = static_cast<uint32_t>(image.cols);
+		entry.height = static_cast<uint32_t>(image.rows);
+
+		for (int row = 0; row < image.rows; row++)
+		{
+			output.write(reinterpret_cast<const char*>(image.ptr<unsigned char>(row)), image.cols);
+		}
+		offset = alignedOffset + static_cast<uint64_t>(image.cols) * image.rows;
+	}
+
+	output.seekp(0);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ImagePackEntry));
+
+	return static_cast<bool>(output);
+}
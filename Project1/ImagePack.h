@@ -0,0 +1,46 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+
+#define IMAGE_PACK_MAGIC 0x4B505046u
+#define IMAGE_PACK_VERSION 1
+//pixels of every image start at multiple of this, rows are stored without padding
+#define IMAGE_PACK_ALIGNMENT 64
+
+typedef struct ImagePackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t imageCount;
+	uint32_t reserved;
+}ImagePackHeader;
+
+typedef struct ImagePackEntry {
+	uint64_t offset;
+	uint32_t width;
+	uint32_t height;
+}ImagePackEntry;
+
+/**
+ * many fingerprints in one file: header, index of entries, raw 8-bit grayscale pixels
+ * images are memory mapped and returned without copying or decoding
+ */
+class ImagePack
+{
+private:
+	MappedFile file;
+	const ImagePackEntry* entries;
+	uint32_t imageCount;
+
+public:
+	ImagePack();
+	bool open(const std::string& path);
+	int getImageCount() const;
+	cv::Mat getImage(int index) const;
+	void prefetch(int index) const;
+
+	static bool pack(const std::string& path, const std::vector<std::string>& imagePaths);
+};
@@ -0,0 +1,159 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+{
+	this->data = nullptr;
+	this->size = 0;
+#ifdef _WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = nullptr;
+#else
+	this->fileDescriptor = -1;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	this->fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (this->fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	this->mappingHandle = CreateFileMappingA(this->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (this->mappingHandle == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	this->data = static_cast<const unsigned char*>(MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	this->fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (this->fileDescriptor < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(this->fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+	this->data = (mapping == MAP_FAILED) ? nullptr : static_cast<const unsigned char*>(mapping);
+	this->size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+	if (this->data == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (this->data != nullptr)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle != nullptr)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(this->fileHandle);
+
+	this->mappingHandle = nullptr;
+	this->fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (this->data != nullptr)
+		munmap(const_cast<unsigned char*>(this->data), this->size);
+	if (this->fileDescriptor >= 0)
+		::close(this->fileDescriptor);
+
+	this->fileDescriptor = -1;
+#endif
+
+	this->data = nullptr;
+	this->size = 0;
+}
+
+
+//file is read from start to end, system can read ahead more aggressively and drop pages behind
+void MappedFile::adviseSequential()
+{
+#ifndef _WIN32
+	if (this->data != nullptr)
+		madvise(const_cast<unsigned char*>(this->data), this->size, MADV_SEQUENTIAL);
+#endif
+}
+
+
+//asks the system to start loading given range, returns immediately
+void MappedFile::prefetch(size_t offset, size_t length) const
+{
+	if (this->data == nullptr || offset >= this->size)
+		return;
+
+	if (offset + length > this->size)
+		length = this->size - offset;
+
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<unsigned char*>(this->data + offset);
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	//madvise needs page aligned address
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t alignedOffset = offset / pageSize * pageSize;
+	madvise(const_cast<unsigned char*>(this->data + alignedOffset), length + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+
+const unsigned char* MappedFile::getData() const
+{
+	return this->data;
+}
+
+
+size_t MappedFile::getSize() const
+{
+	return this->size;
+}
+
+
+bool MappedFile::isOpen() const
+{
+	return this->data != nullptr;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/**
+ * read-only memory mapping of whole file
+ * pages are loaded by the system on first access, nothing is read at open
+ */
+class MappedFile
+{
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+	void adviseSequential();
+	void prefetch(size_t offset, size_t length) const;
+
+	const unsigned char* getData() const;
+	size_t getSize() const;
+	bool isOpen() const;
+};
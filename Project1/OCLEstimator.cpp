@@ -13,60 +13,30 @@ OCLEstimator::OCLEstimator() {
  */
 cv::Mat OCLEstimator::computeOcl(Image* image)
 {
-	cv::Mat img = image->getProcessedImage();
     cv::Mat orientationField = image->getNonSmoothedOrientationField();
-	cv::Mat backgroundMask = image->getBackgroundMask();
-	int blockSize = image->getBlockSize();
 
-	cv::Mat gradX = OrientationsEstimator::calcGradX(img, CV_64F);
-	cv::Mat gradY = OrientationsEstimator::calcGradY(img, CV_64F);
+    //mean gradient tensor of blocks comes from block feature extraction
+    const BlockStatistics& statistics = image->getBlockStatistics();
     
-    cv::Mat oclMap = cv::Mat::zeros(orientationField.size(), CV_64F);
+    //background blocks are skipped
+    BlockGrid<double> oclMap(orientationField.cols, orientationField.rows, BACKGROUND);
 
-    //compute field certainty level for each block
-    for(int blockX = 0; blockX < oclMap.cols; blockX++)
+    //compute field certainty level for each foreground block
+    for(const cv::Point& block : image->getForegroundBlocks().getBlocks())
     {
-        for(int blockY = 0; blockY < oclMap.rows; blockY++)
-        {
-            //skip background
-			if(BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
-			{
-				oclMap.at<double>(blockY, blockX) = BACKGROUND;
-				continue;
-			}
-            
-            double covariance[3] = { 0, 0, 0 };
-
-            //all pixels belonging to block
-            for(int i = 0; i < blockSize; i++)
-            {
-                for(int j = 0; j < blockSize; j++)
-                {
-					int pixelX = blockX * blockSize + i;
-					int pixelY = blockY * blockSize + j;
-					double pixelGradX = gradX.at<double>(pixelY, pixelX);
-					double pixelGradY = gradY.at<double>(pixelY, pixelX);
-
-					covariance[0] += pixelGradX * pixelGradX;
-					covariance[1] += pixelGradY * pixelGradY;
-					covariance[2] += pixelGradX * pixelGradY;
-                }
-            }
-
-			covariance[0] = covariance[0] / (blockSize * blockSize);
-			covariance[1] = covariance[1] / (blockSize * blockSize);
-			covariance[2] = covariance[2] / (blockSize * blockSize);
-
-			double lambdaMin = calcLambdaMin(covariance);
-			double lambdaMax = calcLambdaMax(covariance);			
-
-            if(lambdaMax != 0) oclMap.at<double>(blockY, blockX) = lambdaMin / lambdaMax;
-        }
+        int blockX = block.x;
+        int blockY = block.y;
+        double covariance[3] = { statistics.gxx(block), statistics.gyy(block), statistics.gxy(block) };
+
+		double lambdaMin = calcLambdaMin(covariance);
+		double lambdaMax = calcLambdaMax(covariance);			
+
+        oclMap(blockX, blockY) = (lambdaMax != 0) ? lambdaMin / lambdaMax : 0.;
     }
 
     //convert to range 0 - 255
 	cv::Mat oclMapNorm;
-	oclMap.convertTo(oclMapNorm, CV_8U, 255.0);
+	oclMap.getMat().convertTo(oclMapNorm, CV_8U, 255.0);
 
 	reduceErrorEstimations(oclMapNorm);
 	
@@ -9,46 +9,42 @@ OrientationDiscontinuityDetector::OrientationDiscontinuityDetector() {
 cv::Mat OrientationDiscontinuityDetector::detectDiscontinuities(Image* image) {
 	cv::Mat orientationField = image->getNonSmoothedOrientationField();
 	cv::Mat backgroundMask = image->getBackgroundMask();
-	cv::Mat discontinuityMap = cv::Mat::zeros(orientationField.size(), CV_8U);
+	BlockGrid<double> orientations(orientationField);
 
-	//check all blocks for continuous difference of field
-	for (int blockX = 0; blockX < discontinuityMap.cols; blockX++) {
-		for (int blockY = 0; blockY < discontinuityMap.rows; blockY++) {
-			//skip background areas
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
-				discontinuityMap.at<unsigned char>(blockY, blockX) = BACKGROUND;
-				continue;
-			}
+	//background areas are skipped
+	BlockGrid<unsigned char> discontinuities(orientationField.cols, orientationField.rows, BACKGROUND);
 
-			double currentBlockOrientation = orientationField.at<double>(blockY, blockX);
-		    
-		    //row-wise check for discontinuity
-			if (blockX != (discontinuityMap.cols - 1)) {
-				double nextInRowBlockOrientation = orientationField.at<double>(blockY, blockX + 1);
+	//check all foreground blocks for continuous difference of field
+	for (const cv::Point& block : image->getForegroundBlocks().getBlocks()) {
+		int blockX = block.x;
+		int blockY = block.y;
+		unsigned char state = FOREGROUND;
 
-				if (abs(currentBlockOrientation - nextInRowBlockOrientation) > 45) {
-					discontinuityMap.at<unsigned char>(blockY, blockX) = LOW_DAMAGE;
-				}
+		double currentBlockOrientation = orientations(blockX, blockY);
+
+		//row-wise check for discontinuity
+		if (blockX != (discontinuities.getWidth() - 1)) {
+			double nextInRowBlockOrientation = orientations(blockX + 1, blockY);
+
+			if (abs(currentBlockOrientation - nextInRowBlockOrientation) > 45) {
+				state = LOW_DAMAGE;
 			}
+		}
 
-			//column-wise check for discontinuity
-			if (blockY != (discontinuityMap.rows - 1)) {
-				double nextInColBlockOrientation = orientationField.at<double>(blockY + 1, blockX);
-
-				if (abs(currentBlockOrientation - nextInColBlockOrientation) > 45) {
-                    if(discontinuityMap.at<unsigned char>(blockY, blockX) == LOW_DAMAGE)
-                    {
-						discontinuityMap.at<unsigned char>(blockY, blockX) = DAMAGED;
-                    }
-					else {
-						discontinuityMap.at<unsigned char>(blockY, blockX) = LOW_DAMAGE;
-					}
-				}
+		//column-wise check for discontinuity
+		if (blockY != (discontinuities.getHeight() - 1)) {
+			double nextInColBlockOrientation = orientations(blockX, blockY + 1);
+
+			if (abs(currentBlockOrientation - nextInColBlockOrientation) > 45) {
+				state = (state == LOW_DAMAGE) ? DAMAGED : LOW_DAMAGE;
 			}
 		}
+
+		discontinuities(blockX, blockY) = state;
 	}
 
-	discontinuityMap = suppressErroneousEstimations(discontinuityMap, image->getBackgroundMask());
+	cv::Mat discontinuityMap = discontinuities.getMat();
+	discontinuityMap = suppressErroneousEstimations(discontinuityMap, backgroundMask);
     return discontinuityMap;
 }
 
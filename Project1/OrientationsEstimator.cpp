@@ -5,6 +5,8 @@
 #include "BackgroundSubstractor.h"
 #include "SingularityDetector.h"
 #include "BasicOperations.h"
+#include "FieldQuantizer.h"
+#include "BlockFeatureExtractor.h"
 
 
 OrientationsEstimator::OrientationsEstimator()
@@ -17,38 +19,40 @@ void OrientationsEstimator::computeOrientationField(Image* image)
     cv::Mat img = image->getProcessedImage();
     cv::Size imageSize = img.size();
     int blockSize = image->getBlockSize();
-    cv::Mat orientationField(img.rows / blockSize, img.cols / blockSize, CV_64F);
+    BlockGrid<double> orientationField(img.cols / blockSize, img.rows / blockSize);
 
     //continuous fields for smoothing
-    cv::Mat thetaX(img.rows / blockSize, img.cols / blockSize, CV_64F);
-    cv::Mat thetaY(img.rows / blockSize, img.cols / blockSize, CV_64F);
+    BlockGrid<double> thetaX(img.cols / blockSize, img.rows / blockSize);
+    BlockGrid<double> thetaY(img.cols / blockSize, img.rows / blockSize);
 
-    //compute gradients
-    cv::Mat gradX = calcGradX(img, CV_64F);
-    cv::Mat gradY = calcGradY(img, CV_64F);
+    //gradient tensor of blocks comes from block feature extraction
+    const BlockStatistics& statistics = image->getBlockStatistics();
 
     //calc field for each block at (i,j)
-    for (int blockX = 0; blockX < orientationField.cols; blockX++)
+    for (int blockY = 0; blockY < orientationField.getHeight(); blockY++)
     {
-        for (int blockY = 0; blockY < orientationField.rows; blockY++)
+        for (int blockX = 0; blockX < orientationField.getWidth(); blockX++)
         {
-            double angle = calculateAvgAngleForBlock(blockX, blockY, blockSize, gradX, gradY, img);
-            orientationField.at<double>(blockY, blockX) = angle;
-            //vector elements used for smoothing
-            thetaX.at<double>(blockY, blockX) = cos(2. * (angle * CV_PI / 180.));
-            thetaY.at<double>(blockY, blockX) = sin(2. * (angle * CV_PI / 180.));
+            double Vx = 2 * statistics.gxy(blockX, blockY);
+            double Vy = statistics.gxx(blockX, blockY) - statistics.gyy(blockX, blockY);
+
+            //vector elements used for smoothing come directly from gradient features
+            orientationField(blockX, blockY) = orientationFromTensor(Vx, Vy, &thetaX(blockX, blockY), &thetaY(blockX, blockY));
         }
     }
 
-	smoothenFingerPrintBordersOrientations(&orientationField, &thetaX, &thetaY, image->getBackgroundMask());
+	cv::Mat orientationFieldMat = orientationField.getMat();
+	cv::Mat thetaXMat = thetaX.getMat();
+	cv::Mat thetaYMat = thetaY.getMat();
+	smoothenFingerPrintBordersOrientations(&orientationFieldMat, &thetaXMat, &thetaYMat, image->getBackgroundMask());
 
-    thetaX.copyTo(this->thetaX);
-    thetaY.copyTo(this->thetaY);
-	thetaX.copyTo(image->thetaX);
-	thetaY.copyTo(image->thetaY);
+    thetaXMat.copyTo(this->thetaX);
+    thetaYMat.copyTo(this->thetaY);
+	thetaXMat.copyTo(image->thetaX);
+	thetaYMat.copyTo(image->thetaY);
 
-    image->setNonSmoothedOrientationField(orientationField);
-	image->setOrientationField(orientationField);
+    image->setNonSmoothedOrientationField(orientationFieldMat);
+	image->setOrientationField(orientationFieldMat);
 }
 
 
@@ -57,32 +61,28 @@ cv::Mat OrientationsEstimator::computeOrientationField(Image* image, int blockSi
 	cv::Mat img = image->getProcessedImage();
 	cv::Size imageSize = img.size();
 	int fieldsSize = (img.rows / blockSize == 0) ? img.rows / blockSize : (img.rows / blockSize) + 1;
-	cv::Mat orientationField(fieldsSize, fieldsSize, CV_64F);
+	BlockGrid<double> orientationField(fieldsSize, fieldsSize);
 
 	//continuous fields for smoothing
-	cv::Mat thetaX(fieldsSize, fieldsSize, CV_64F);
-	cv::Mat thetaY(fieldsSize, fieldsSize, CV_64F);
+	BlockGrid<double> thetaX(fieldsSize, fieldsSize);
+	BlockGrid<double> thetaY(fieldsSize, fieldsSize);
 
-	//compute gradients
-	cv::Mat gradX = calcGradX(img, CV_64F);
-	cv::Mat gradY = calcGradY(img, CV_64F);
+	//pixel tensor is computed once per image by block feature extraction, every scale reuses it
+	const GradientField& gradients = image->getGradientField();
 
 	//calc field for each block at (i,j)
-	for (int i = 0; i < orientationField.cols; i++)
+	for (int j = 0; j < orientationField.getHeight(); j++)
 	{
-		for (int j = 0; j < orientationField.rows; j++)
+		for (int i = 0; i < orientationField.getWidth(); i++)
 		{
-			double angle = calculateAvgAngleForBlock(i, j, blockSize, gradX, gradY, img);
-			orientationField.at<double>(j, i) = angle;
-			//vector elements used for smoothing
-			thetaX.at<double>(j, i) = cos(2. * (angle * CV_PI / 180.));
-			thetaY.at<double>(j, i) = sin(2. * (angle * CV_PI / 180.));
+			//vector elements used for smoothing come directly from gradient features
+			orientationField(i, j) = calculateAvgAngleForBlock(i, j, blockSize, gradients, &thetaX(i, j), &thetaY(i, j));
 		}
 	}
 
-	thetaX.copyTo(*thetaXOut);
-	thetaY.copyTo(*thetaYOut);
-	return orientationField;
+	*thetaXOut = thetaX.getMat();
+	*thetaYOut = thetaY.getMat();
+	return orientationField.getMat();
 }
 
 
@@ -106,18 +106,20 @@ cv::Mat OrientationsEstimator::drawOrientationField(Image* image, bool smooth)
     //darker 
 	finalImage /= 2;
 
-    for (int oFieldCoordX = 0; oFieldCoordX < orientationField.cols; oFieldCoordX++)
+    BlockGrid<double> orientations(orientationField);
+
+    for (int oFieldCoordY = 0; oFieldCoordY < orientations.getHeight(); oFieldCoordY++)
     {
-        for (int oFieldCoordY = 0; oFieldCoordY < orientationField.rows; oFieldCoordY++)
+        for (int oFieldCoordX = 0; oFieldCoordX < orientations.getWidth(); oFieldCoordX++)
         {
             cv::Point lineStartPoint(
                 static_cast<int>(oFieldCoordX * blockSize),
                 static_cast<int>(oFieldCoordY * blockSize));
 
             cv::Scalar vector(
-                //needs to be converted from degrees to radians
-                cos(orientationField.at<double>(oFieldCoordY, oFieldCoordX) * CV_PI / 180.0),
-                sin(orientationField.at<double>(oFieldCoordY, oFieldCoordX) * CV_PI / 180.0));
+                //table lookup of quantized orientation
+                FieldQuantizer::cosine(FieldQuantizer::quantizeOrientation(orientations(oFieldCoordX, oFieldCoordY))),
+                FieldQuantizer::sine(FieldQuantizer::quantizeOrientation(orientations(oFieldCoordX, oFieldCoordY))));
 
             cv::Point lineEndPoint(
                 static_cast<int>(lineStartPoint.x + (blockSize * vector.val[0])),
@@ -140,18 +142,20 @@ cv::Mat OrientationsEstimator::drawOrientationFieldCustom(Image* image, cv::Mat
 	//darker 
 	finalImage /= 2;
 
-	for (int oFieldCoordX = 0; oFieldCoordX < orientationField.cols; oFieldCoordX++)
+	BlockGrid<double> orientations(orientationField);
+
+	for (int oFieldCoordY = 0; oFieldCoordY < orientations.getHeight(); oFieldCoordY++)
 	{
-		for (int oFieldCoordY = 0; oFieldCoordY < orientationField.rows; oFieldCoordY++)
+		for (int oFieldCoordX = 0; oFieldCoordX < orientations.getWidth(); oFieldCoordX++)
 		{
 			cv::Point lineStartPoint(
 				static_cast<int>(oFieldCoordX * blockSize),
 				static_cast<int>(oFieldCoordY * blockSize));
 
 			cv::Scalar vector(
-				//needs to be converted from degrees to radians
-				cos(orientationField.at<double>(oFieldCoordY, oFieldCoordX) * CV_PI / 180.0),
-				sin(orientationField.at<double>(oFieldCoordY, oFieldCoordX) * CV_PI / 180.0));
+				//table lookup of quantized orientation
+				FieldQuantizer::cosine(FieldQuantizer::quantizeOrientation(orientations(oFieldCoordX, oFieldCoordY))),
+				FieldQuantizer::sine(FieldQuantizer::quantizeOrientation(orientations(oFieldCoordX, oFieldCoordY))));
 
 			cv::Point lineEndPoint(
 				static_cast<int>(lineStartPoint.x + (blockSize * vector.val[0])),
@@ -169,15 +173,25 @@ cv::Mat OrientationsEstimator::drawOrientationFieldCustom(Image* image, cv::Mat
 
 cv::Mat OrientationsEstimator::extendMatrixSizeBlockwise(cv::Mat mat, int blockSize, const cv::Size& size)
 {
-	cv::Mat matExtendedSize = cv::Mat::zeros(size, CV_64F);
+	cv::Mat matExtendedSize(size, CV_PIXEL);
+	extendMatrixSizeBlockwise(mat, blockSize, matExtendedSize);
+	return matExtendedSize;
+}
+
+
+//fills already allocated full size matrix
+void OrientationsEstimator::extendMatrixSizeBlockwise(const cv::Mat& mat, int blockSize, cv::Mat& matExtendedSize)
+{
+	BlockGrid<double> blocks(mat);
 
-	for (int i = 0; i < matExtendedSize.cols; i++) {
-		for (int j = 0; j < matExtendedSize.rows; j++) {
-			matExtendedSize.at<double>(j, i) = mat.at<double>(j / blockSize, i / blockSize);
+	for (int j = 0; j < matExtendedSize.rows; j++) {
+		pixel_t* pixelRow = matExtendedSize.ptr<pixel_t>(j);
+		const double* blockRow = blocks.row(j / blockSize);
+
+		for (int i = 0; i < matExtendedSize.cols; i++) {
+			pixelRow[i] = static_cast<pixel_t>(blockRow[i / blockSize]);
 		}
 	}
-
-	return matExtendedSize;
 }
 
 
@@ -185,40 +199,34 @@ void OrientationsEstimator::smoothenOrientationField(const cv::Mat& thetaX, cons
                                                      Image* image)
 {
     cv::Mat orientationField = image->getNonSmoothedOrientationField();
-    cv::Mat img = image->getProcessedImage();
     int blockSize = image->getBlockSize();
 
-    //get 2D gaussian kernel
-    int kernelSize = 5 * blockSize;
-    cv::Mat gaussKernel = Filter::get2DGaussianKernel(kernelSize, kernelSize, 20, 20);
+    cv::Mat smoothedThetaX;
+    cv::Mat smoothedThetaY;
+    smoothenThetaFields(thetaX, thetaY, image, blockSize, 5 * blockSize, &smoothedThetaX, &smoothedThetaY);
 
-    cv::Mat smoothedThetaX = cv::Mat::zeros(img.size(), CV_64F);
-    cv::Mat smoothedThetaY = cv::Mat::zeros(img.size(), CV_64F);
     cv::Mat smoothedOrientationField;
     orientationField.copyTo(smoothedOrientationField);
 
-	//extend matrix to the size of original image for better averaging 
-	cv::Mat thetaXFullSize = extendMatrixSizeBlockwise(thetaX, blockSize, img.size());
-    cv::Mat thetaYFullSize = extendMatrixSizeBlockwise(thetaY, blockSize, img.size());
-
-    //convolve
-    filter2D(thetaXFullSize, smoothedThetaX, CV_64F, gaussKernel);
-    filter2D(thetaYFullSize, smoothedThetaY, CV_64F, gaussKernel);
+    BlockGrid<double> smoothedOrientations(smoothedOrientationField);
+    BlockGrid<double> smoothedThetasX(smoothedThetaX);
+    BlockGrid<double> smoothedThetasY(smoothedThetaY);
+    BlockGrid<double> imageThetaX(image->thetaX);
+    BlockGrid<double> imageThetaY(image->thetaY);
 
-    //average values of field vectors for each block non-weighted averaging
-    for (int i = 0; i < orientationField.cols; i++)
+    for (int j = 0; j < smoothedOrientations.getHeight(); j++)
     {
-        for (int j = 0; j < orientationField.rows; j++)
+        for (int i = 0; i < smoothedOrientations.getWidth(); i++)
         {
-            double smoothedThetaXBlock = calcAvgForBlock(smoothedThetaX, blockSize, i, j);
-            double smoothedThetaYBlock = calcAvgForBlock(smoothedThetaY, blockSize, i, j);
+            double smoothedThetaXBlock = smoothedThetasX(i, j);
+            double smoothedThetaYBlock = smoothedThetasY(i, j);
 
 			//save in image 
-			image->thetaX.at<double>(j, i) = smoothedThetaXBlock;
-			image->thetaY.at<double>(j, i) = smoothedThetaYBlock;
+			imageThetaX(i, j) = smoothedThetaXBlock;
+			imageThetaY(i, j) = smoothedThetaYBlock;
 
             //convert field vector to angle
-            smoothedOrientationField.at<double>(j, i) = 0.5 * cv::fastAtan2(smoothedThetaYBlock, smoothedThetaXBlock);
+            smoothedOrientations(i, j) = 0.5 * cv::fastAtan2(smoothedThetaYBlock, smoothedThetaXBlock);
         }
     }
     image->setOrientationField(smoothedOrientationField);
@@ -228,50 +236,85 @@ void OrientationsEstimator::smoothenOrientationField(const cv::Mat& thetaX, cons
 cv::Mat OrientationsEstimator::smoothenOrientationField(const cv::Mat& thetaX, const cv::Mat& thetaY,
 	Image* image, int blockSize, cv::Mat orientationField)
 {
-	cv::Mat img = image->getProcessedImage();
-
-	//get 2D gaussian kernel
-	int kernelSize = 2 * blockSize;
-	cv::Mat gaussKernel = Filter::get2DGaussianKernel(kernelSize, kernelSize, 20, 20);
+	cv::Mat smoothedThetaX;
+	cv::Mat smoothedThetaY;
+	smoothenThetaFields(thetaX, thetaY, image, blockSize, 2 * blockSize, &smoothedThetaX, &smoothedThetaY);
 
-	cv::Mat smoothedThetaX = cv::Mat::zeros(img.size(), CV_64F);
-	cv::Mat smoothedThetaY = cv::Mat::zeros(img.size(), CV_64F);
 	cv::Mat smoothedOrientationField;
 	orientationField.copyTo(smoothedOrientationField);
 
+	BlockGrid<double> smoothedOrientations(smoothedOrientationField);
+	BlockGrid<double> smoothedThetasX(smoothedThetaX);
+	BlockGrid<double> smoothedThetasY(smoothedThetaY);
+
+	for (int j = 0; j < smoothedOrientations.getHeight(); j++)
+	{
+		for (int i = 0; i < smoothedOrientations.getWidth(); i++)
+		{
+			//convert field vector to angle
+			smoothedOrientations(i, j) = 0.5 * cv::fastAtan2(smoothedThetasY(i, j), smoothedThetasX(i, j));
+		}
+	}
+
+	return smoothedOrientationField;
+}
+
+
+/**
+ * gaussian smoothing of field vectors, result is per block
+ * default is the equivalent block kernel, full resolution convolution is kept for comparison
+ */
+void OrientationsEstimator::smoothenThetaFields(const cv::Mat& thetaX, const cv::Mat& thetaY, Image* image, int blockSize,
+	int kernelSize, cv::Mat* smoothedThetaXOut, cv::Mat* smoothedThetaYOut)
+{
+#if FULL_RESOLUTION_SMOOTHING
+	cv::Mat img = image->getProcessedImage();
+	cv::Mat smoothedThetaX = image->acquireBuffer(SMOOTHED_THETA_X, img.size(), CV_PIXEL);
+	cv::Mat smoothedThetaY = image->acquireBuffer(SMOOTHED_THETA_Y, img.size(), CV_PIXEL);
+
 	//extend matrix to the size of original image for better averaging 
-	cv::Mat thetaXFullSize = extendMatrixSizeBlockwise(thetaX, blockSize, img.size());
-	cv::Mat thetaYFullSize = extendMatrixSizeBlockwise(thetaY, blockSize, img.size());
+	cv::Mat thetaXFullSize = image->acquireBuffer(THETA_X_FULL_SIZE, img.size(), CV_PIXEL);
+	cv::Mat thetaYFullSize = image->acquireBuffer(THETA_Y_FULL_SIZE, img.size(), CV_PIXEL);
+	extendMatrixSizeBlockwise(thetaX, blockSize, thetaXFullSize);
+	extendMatrixSizeBlockwise(thetaY, blockSize, thetaYFullSize);
 
 	//convolve
-	filter2D(thetaXFullSize, smoothedThetaX, CV_64F, gaussKernel);
-	filter2D(thetaYFullSize, smoothedThetaY, CV_64F, gaussKernel);
+	Filter::smoothenGaussian(thetaXFullSize, smoothedThetaX, kernelSize, 20);
+	Filter::smoothenGaussian(thetaYFullSize, smoothedThetaY, kernelSize, 20);
+
+	BlockGrid<double> smoothedThetasX(thetaX.cols, thetaX.rows);
+	BlockGrid<double> smoothedThetasY(thetaY.cols, thetaY.rows);
 
 	//average values of field vectors for each block non-weighted averaging
-	for (int i = 0; i < orientationField.cols; i++)
+	for (int j = 0; j < smoothedThetasX.getHeight(); j++)
 	{
-		for (int j = 0; j < orientationField.rows; j++)
+		for (int i = 0; i < smoothedThetasX.getWidth(); i++)
 		{
-			double smoothedThetaXBlock = calcAvgForBlock(smoothedThetaX, blockSize, i, j);
-			double smoothedThetaYBlock = calcAvgForBlock(smoothedThetaY, blockSize, i, j);
-			
-			//convert field vector to angle
-			smoothedOrientationField.at<double>(j, i) = 0.5 * cv::fastAtan2(smoothedThetaYBlock, smoothedThetaXBlock);
+			smoothedThetasX(i, j) = calcAvgForBlock(smoothedThetaX, blockSize, i, j);
+			smoothedThetasY(i, j) = calcAvgForBlock(smoothedThetaY, blockSize, i, j);
 		}
 	}
 
-	return smoothedOrientationField;
+	*smoothedThetaXOut = smoothedThetasX.getMat();
+	*smoothedThetaYOut = smoothedThetasY.getMat();
+#else
+	Filter::smoothenBlockField(thetaX, *smoothedThetaXOut, kernelSize, 20, blockSize);
+	Filter::smoothenBlockField(thetaY, *smoothedThetaYOut, kernelSize, 20, blockSize);
+#endif
 }
 
 
 void OrientationsEstimator::smoothenFingerPrintBordersOrientations(cv::Mat* orientationField, cv::Mat* thetaX,
 	cv::Mat* thetaY, const cv::Mat& backgroundMask)
 {
-	cv::Mat show = cv::Mat::zeros(orientationField->size(), CV_8U);
+	BlockGrid<double> orientations(*orientationField);
+	BlockGrid<double> thetasX(*thetaX);
+	BlockGrid<double> thetasY(*thetaY);
 
-	for(int blockX = 0; blockX < orientationField->cols; blockX++)
+	//border blocks can be overwritten from several inner blocks, blocks are visited column by column
+	for(int blockX = 0; blockX < orientations.getWidth(); blockX++)
 	{
-		for(int blockY = 0; blockY < orientationField->rows; blockY++)
+		for(int blockY = 0; blockY < orientations.getHeight(); blockY++)
 		{
 			if(BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
 			{
@@ -280,8 +323,6 @@ void OrientationsEstimator::smoothenFingerPrintBordersOrientations(cv::Mat* orie
 			
 			if (BackgroundSubstractor::hasBackgroundNeighbor(blockX, blockY, backgroundMask))
 			{
-				show.at<unsigned char>(blockY, blockX) = 127;
-
 				vector<cv::Point> area3x3 = BasicOperations::getSurroundingPoints(blockX, blockY);
 
 				//find neighboring inner block, its value will be copied to border block and surrounding background
@@ -290,21 +331,19 @@ void OrientationsEstimator::smoothenFingerPrintBordersOrientations(cv::Mat* orie
 				//no value to be copied, does not have inner block as neighbor
 				if (innerBlock.x == 0 && innerBlock.y == 0) continue;
 
-				show.at<unsigned char>(innerBlock) = 200;
-
 				//include self
 				area3x3.push_back(cv::Point(blockX, blockY));
 
 				for (auto block : area3x3)
 				{
-					if (Image::isElementInMatSizeRange(block.x, block.y, backgroundMask))
+					if (orientations.isInRange(block.x, block.y))
 					{
 						if (BackgroundSubstractor::isBackgroundBlock(block.x, block.y, backgroundMask) ||
 							BackgroundSubstractor::hasBackgroundNeighbor(block.x, block.y, backgroundMask))
 						{
-							orientationField->at<double>(block) = orientationField->at<double>(innerBlock);
-							thetaX->at<double>(block) = thetaX->at<double>(innerBlock);
-							thetaY->at<double>(block) = thetaY->at<double>(innerBlock);
+							orientations(block) = orientations(innerBlock);
+							thetasX(block) = thetasX(innerBlock);
+							thetasY(block) = thetasY(innerBlock);
 						}
 					}
 				}
@@ -335,49 +374,49 @@ cv::Point OrientationsEstimator::findNeighboringInnerBlock(const vector<cv::Poin
 }
 
 
-cv::Mat OrientationsEstimator::calcGradX(cv::Mat& img, int valuesType)
+//writes to given matrix, it is not reallocated when size and type match
+void OrientationsEstimator::calcGradX(const cv::Mat& img, cv::Mat& gradX, int valuesType)
 {
-    cv::Mat gradX(img.size(), valuesType);
     Scharr(img, gradX, valuesType, 1, 0, 5);
-    return gradX;
 }
 
 
-cv::Mat OrientationsEstimator::calcGradY(cv::Mat& img, int valuesType)
+void OrientationsEstimator::calcGradY(const cv::Mat& img, cv::Mat& gradY, int valuesType)
 {
-    cv::Mat gradY(img.size(), valuesType);
     Scharr(img, gradY, valuesType, 0, 1, 5);
-    return gradY;
 }
 
 
+//block tensor of any size is read from integral image in constant time
 double OrientationsEstimator::calculateAvgAngleForBlock(int blockCoordX, int blockCoordY, int blockSize,
-                                                        const cv::Mat& gradX, const cv::Mat& gradY, cv::Mat& img)
+                                                        const GradientField& gradients, double* thetaXOut, double* thetaYOut)
 {
-    double Vx = 0;
-    double Vy = 0;
+    cv::Rect block(blockCoordX * blockSize, blockCoordY * blockSize, blockSize, blockSize);
+    cv::Vec3d tensorSum = BlockFeatureExtractor::getTensorSum(gradients, block);
 
-    //iterate over pixel belonging to current block + calculate Vx and Vy features
-	int limitX = (blockCoordX * blockSize + blockSize <= img.cols) ? blockCoordX * blockSize + blockSize : img.cols;
-	int limitY = (blockCoordY * blockSize + blockSize <= img.rows) ? blockCoordY * blockSize + blockSize : img.rows;
+    return orientationFromTensor(2 * tensorSum[2], tensorSum[0] - tensorSum[1], thetaXOut, thetaYOut);
+}
 
-    for (int u = blockCoordX * blockSize; u < limitX; u++)
-    {
-        for (int v = blockCoordY * blockSize; v < limitY; v++)
-        {
-            double pixelGradX = gradX.at<double>(v, u);
-            double pixelGradY = gradY.at<double>(v, u);
-            Vx += (2 * pixelGradX * pixelGradY);
-            Vy += (pixelGradX * pixelGradX - pixelGradY * pixelGradY);
-        }
-    }
 
-    //estimate angle from calculated features
+/**
+ * angle = 90 + atan2(Vx, Vy) / 2, so doubled angle vector is (-Vy, -Vx) / |V|
+ * features may be sums or means over block, both give the same angle
+ */
+double OrientationsEstimator::orientationFromTensor(double Vx, double Vy, double* thetaXOut, double* thetaYOut)
+{
     double angle = 0.;
 
+    //zero angle
+    *thetaXOut = 1.;
+    *thetaYOut = 0.;
+
     if (Vx != 0)
     {
         angle = 90.0 + (0.5 * cv::fastAtan2(Vx, Vy));
+
+        double magnitude = sqrt(Vx * Vx + Vy * Vy);
+        *thetaXOut = -Vy / magnitude;
+        *thetaYOut = -Vx / magnitude;
     }
 
     return angle;
@@ -392,11 +431,13 @@ double OrientationsEstimator::calcAvgForBlock(const cv::Mat& mat, int blockSize,
 	int limitX = (blockX * blockSize + blockSize < mat.cols) ? blockX * blockSize + blockSize : mat.cols - 1;
 	int limitY = (blockY * blockSize + blockSize < mat.rows) ? blockY * blockSize + blockSize : mat.rows - 1;
 
-    for (int i = blockX * blockSize; i < limitX; i++)
+    for (int j = blockY * blockSize; j < limitY; j++)
     {
-        for (int j = blockY * blockSize; j < limitY; j++)
+        const pixel_t* matRow = mat.ptr<pixel_t>(j);
+
+        for (int i = blockX * blockSize; i < limitX; i++)
         {
-            sum += mat.at<double>(j, i);
+            sum += matRow[i];
         }
     }
     sum /= (blockSize * blockSize);
@@ -418,7 +459,7 @@ cv::Mat OrientationsEstimator::getThetaY()
 
 void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 {
-	vector<ImageArea> damageAreas = image->getHighlyDamagedAreas();
+	const vector<ImageArea>& damageAreas = image->getHighlyDamagedAreas();
 	vector<int> damageSizes;
 
 	//no damaged areas
@@ -426,10 +467,9 @@ void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 		return;
 
 	//get areas sizes
-	for (ImageArea damageArea : damageAreas)
+	for (const ImageArea& damageArea : damageAreas)
 	{
-		int smallerDimension = (damageArea.getHeight() < damageArea.getWidth()) ? damageArea.getHeight() : damageArea.getWidth();
-		damageSizes.push_back(smallerDimension);
+		damageSizes.push_back(damageArea.getMinDimension());
 	}
 
 	vector<int>::iterator maxSize;
@@ -439,7 +479,7 @@ void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 
 	//size of range of damage areas sizes, for which one oField will be generated
 	int rangeSize = 2;
-	auto oEstimator = new OrientationsEstimator();
+	auto oEstimator = OrientationsEstimator();
 	vector<ToFieldWrapper> customOrientationFields;
 	vector<TAreaOFieldMapper> areasOFieldsMapper;
 
@@ -463,7 +503,7 @@ void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 					//oField of current size has already been generated
 					for (int i = 0; i < customOrientationFields.size(); i++)
 					{
-						ToFieldWrapper oFieldWrapper = customOrientationFields.at(i);
+						const ToFieldWrapper& oFieldWrapper = customOrientationFields.at(i);
 
 						if(oFieldWrapper.rangeBegin == rangeBegin)
 						{
@@ -481,8 +521,8 @@ void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 					cv::Mat thetaX;
 					cv::Mat thetaY;
 					
-					orientationField = oEstimator->computeOrientationField(image, customBlockSize, &thetaX, &thetaY);
-					orientationField = oEstimator->smoothenOrientationField(thetaX, thetaY, image, customBlockSize, orientationField);
+					orientationField = oEstimator.computeOrientationField(image, customBlockSize, &thetaX, &thetaY);
+					orientationField = oEstimator.smoothenOrientationField(thetaX, thetaY, image, customBlockSize, orientationField);
 
 					areaOfSizeInCurrentRangeFound = true;
 
@@ -518,10 +558,13 @@ void OrientationsEstimator::updateOrientationsBasedOnDamage(Image* image)
 
 
 void OrientationsEstimator::setMostAppropriateOrientationToAreas(Image* image,
-	vector<ToFieldWrapper> customOrientationFields, vector<TareaOFieldMapper> areasOFieldsMapper)
+	const vector<ToFieldWrapper>& customOrientationFields, const vector<TareaOFieldMapper>& areasOFieldsMapper)
 {
-	vector<ImageArea> damagedAreas = image->getHighlyDamagedAreas();
+	const vector<ImageArea>& damagedAreas = image->getHighlyDamagedAreas();
 	cv::Mat orientationField = image->getOrientationField();
+	BlockGrid<double> orientations(orientationField);
+	BlockGrid<double> imageThetaX(image->thetaX);
+	BlockGrid<double> imageThetaY(image->thetaY);
 
 	//update orientations in all damaged areas
 	for(int areaIndex = 0; areaIndex < damagedAreas.size(); areaIndex++)
@@ -536,16 +579,16 @@ void OrientationsEstimator::setMostAppropriateOrientationToAreas(Image* image,
 		cv::Mat customOrientationField = customOrientationFields.at(oFieldIndex).field;
 
 		//change field for all blocks that belong to current area
-		for (cv::Point blockPosition : damagedAreas.at(areaIndex).getPoints())
+		for (const cv::Point& blockPosition : damagedAreas.at(areaIndex).getPoints())
 		{
 			double blockThetaX;
 			double blockThetaY;
 			double newOrientation = getCustomOrientationValueForBlock(blockPosition, customOrientationField, customOrientationFields.at(oFieldIndex).blockSize, 
 				image->getBlockSize(), image->getSize(), &thetaX, &thetaY, &blockThetaX, &blockThetaY);
 
-			orientationField.at<double>(blockPosition) = newOrientation;
-			image->thetaX.at<double>(blockPosition) = blockThetaX;
-			image->thetaY.at<double>(blockPosition) = blockThetaY;
+			orientations(blockPosition) = newOrientation;
+			imageThetaX(blockPosition) = blockThetaX;
+			imageThetaY(blockPosition) = blockThetaY;
 		}
 	}
 
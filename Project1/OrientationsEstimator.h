@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Image.h"
+#include "BlockGrid.h"
 #include "ToFieldWrapper.h"
 #include "TareaOFieldMapper.h"
 #include <vector>
@@ -19,25 +20,30 @@ public:
     void smoothenOrientationField(const cv::Mat& thetaX, const cv::Mat& thetaY, Image* image);
     cv::Mat smoothenOrientationField(const cv::Mat& thetaX, const cv::Mat& thetaY, Image* image, int blockSize,
                                      cv::Mat orientationField);
+    void smoothenThetaFields(const cv::Mat& thetaX, const cv::Mat& thetaY, Image* image, int blockSize, int kernelSize,
+                             cv::Mat* smoothedThetaXOut, cv::Mat* smoothedThetaYOut);
     
 	void smoothenFingerPrintBordersOrientations(cv::Mat* orientationField, cv::Mat* thetaX, cv::Mat* thetaY, const cv::Mat& backgroundMask);
     cv::Point findNeighboringInnerBlock(const vector<cv::Point_<int>>& surroundingBlocks, const cv::Mat& backgroundMask);
    
-	double calculateAvgAngleForBlock(int blockCoordX, int blockCoordY, int blockSize, const cv::Mat& gradX, const cv::Mat& gradY, cv::Mat& img);
+	double calculateAvgAngleForBlock(int blockCoordX, int blockCoordY, int blockSize, const GradientField& gradients,
+		double* thetaXOut, double* thetaYOut);
+	static double orientationFromTensor(double Vx, double Vy, double* thetaXOut, double* thetaYOut);
 
     cv::Mat getThetaX();
     cv::Mat getThetaY();
    
-    static cv::Mat calcGradX(cv::Mat& img, int valuesType);
-	static cv::Mat calcGradY(cv::Mat& img, int valuesType);
+    static void calcGradX(const cv::Mat& img, cv::Mat& gradX, int valuesType);
+    static void calcGradY(const cv::Mat& img, cv::Mat& gradY, int valuesType);
 
     static double calcAvgForBlock(const cv::Mat& mat, int blockSize, int blockX, int blockY);
 	static cv::Mat extendMatrixSizeBlockwise(cv::Mat mat, int blockSize, const cv::Size& size);
+	static void extendMatrixSizeBlockwise(const cv::Mat& mat, int blockSize, cv::Mat& matExtendedSize);
     static cv::Mat drawOrientationField(Image* image, bool smooth);
     cv::Mat drawOrientationFieldCustom(Image* image, cv::Mat orientationField, int blockSize);
 
     void updateOrientationsBasedOnDamage(Image* image);
-    void setMostAppropriateOrientationToAreas(Image* image, vector<ToFieldWrapper> customOrientationFields, vector<TareaOFieldMapper> areasOFieldsMapper);
+    void setMostAppropriateOrientationToAreas(Image* image, const vector<ToFieldWrapper>& customOrientationFields, const vector<TareaOFieldMapper>& areasOFieldsMapper);
     int getOFieldIndex(int areaIndex, const vector<TareaOFieldMapper>& areasOFieldMapper);
     double getCustomOrientationValueForBlock(const cv::Point& blockPosition, const cv::Mat& customOrientationField,int customBlockSize, int originalBlockSize,
 		const cv::Size& imageSize, cv::Mat* thetaX, cv::Mat* thetaY, double* blockThetaXOut, double* blockThetaYOut);
@@ -0,0 +1,14 @@
+#pragma once
+#include <opencv2/core/mat.hpp>
+
+/**
+ * average intensities of lines of oriented window of every block
+ * row blockY * blocksX + blockX holds windowWidth values, rows of background blocks stay zero
+ */
+typedef struct OrientedSignatures {
+	//x-signatures of processed image, used for frequency estimation
+	cv::Mat intensity;
+
+	//line averages of binarized image, used for ridge clarity
+	cv::Mat binarized;
+}OrientedSignatures;
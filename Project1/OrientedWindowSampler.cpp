@@ -0,0 +1,112 @@
+#include "OrientedWindowSampler.h"
+#include "Preprocessor.h"
+#include <climits>
+#include <algorithm>
+
+
+OrientedWindowSampler::OrientedWindowSampler(int blockSize, int windowWidth)
+{
+	this->blockSize = blockSize;
+	this->windowWidth = windowWidth;
+}
+
+
+/**
+ * same pixel coordinates as were computed with trigonometry for every pixel of every block,
+ * offset is floor of rotated position, pixel position is block center plus offset
+ */
+const vector<cv::Point>& OrientedWindowSampler::getOffsets(int orientationBin)
+{
+	vector<cv::Point>& binOffsets = this->offsets[orientationBin];
+	if (!binOffsets.empty())
+		return binOffsets;
+
+	double cosine = FieldQuantizer::cosine(orientationBin);
+	double sine = FieldQuantizer::sine(orientationBin);
+	int minX = INT_MAX, maxX = INT_MIN, minY = INT_MAX, maxY = INT_MIN;
+
+	binOffsets.reserve(this->windowWidth * this->blockSize);
+
+	for (int lineIndex = 0; lineIndex < this->windowWidth; lineIndex++)
+	{
+		for (int linePixelIndex = 0; linePixelIndex < this->blockSize; linePixelIndex++)
+		{
+			int offsetX = static_cast<int>(floor(
+				(linePixelIndex - this->blockSize / 2) * cosine + (lineIndex - this->windowWidth / 2) * sine));
+			int offsetY = static_cast<int>(floor(
+				(linePixelIndex - this->blockSize / 2) * sine + (this->windowWidth / 2 - lineIndex) * cosine));
+
+			binOffsets.push_back(cv::Point(offsetX, offsetY));
+
+			minX = min(minX, offsetX);
+			maxX = max(maxX, offsetX);
+			minY = min(minY, offsetY);
+			maxY = max(maxY, offsetY);
+		}
+	}
+
+	this->offsetBounds[orientationBin] = cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+	return binOffsets;
+}
+
+
+/**
+ * processed and binarized image are sampled in one pass over window of every foreground block
+ * lines are averaged over their pixels inside of the image
+ */
+void OrientedWindowSampler::sample(Image* image)
+{
+	const cv::Mat& img = image->getProcessedImage();
+	cv::Mat binarizedImg = Preprocessor::binarize(image);
+	BlockGrid<unsigned char> orientationBins(image->getQuantizedOrientationField());
+	cv::Rect imageArea(0, 0, img.cols, img.rows);
+
+	OrientedSignatures signatures;
+	signatures.intensity = cv::Mat::zeros(orientationBins.count(), this->windowWidth, CV_64F);
+	signatures.binarized = cv::Mat::zeros(orientationBins.count(), this->windowWidth, CV_64F);
+
+	for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
+	{
+		unsigned char orientationBin = orientationBins(block);
+		const vector<cv::Point>& windowOffsets = getOffsets(orientationBin);
+
+		cv::Point blockCenter(block.x * this->blockSize + (this->blockSize - 1) / 2, block.y * this->blockSize + (this->blockSize - 1) / 2);
+		cv::Rect windowBounds(blockCenter + this->offsetBounds[orientationBin].tl(), this->offsetBounds[orientationBin].size());
+
+		//most windows are whole inside of the image and need no check per pixel
+		bool inside = (windowBounds & imageArea) == windowBounds;
+
+		int row = block.y * orientationBins.getWidth() + block.x;
+		double* intensityLines = signatures.intensity.ptr<double>(row);
+		double* binarizedLines = signatures.binarized.ptr<double>(row);
+		const cv::Point* offset = windowOffsets.data();
+
+		for (int lineIndex = 0; lineIndex < this->windowWidth; lineIndex++)
+		{
+			int intensitySum = 0;
+			int binarizedSum = 0;
+			int validPixels = 0;
+
+			for (int linePixelIndex = 0; linePixelIndex < this->blockSize; linePixelIndex++, offset++)
+			{
+				int pixelX = blockCenter.x + offset->x;
+				int pixelY = blockCenter.y + offset->y;
+
+				if (!inside && !imageArea.contains(cv::Point(pixelX, pixelY)))
+					continue;
+
+				intensitySum += img.ptr<unsigned char>(pixelY)[pixelX];
+				binarizedSum += binarizedImg.ptr<unsigned char>(pixelY)[pixelX];
+				validPixels++;
+			}
+
+			if (validPixels != 0)
+			{
+				intensityLines[lineIndex] = static_cast<double>(intensitySum) / validPixels;
+				binarizedLines[lineIndex] = static_cast<double>(binarizedSum) / validPixels;
+			}
+		}
+	}
+
+	image->setOrientedSignatures(std::move(signatures));
+}
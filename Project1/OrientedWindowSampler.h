@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Image.h"
+#include "OrientedSignatures.h"
+#include "FieldQuantizer.h"
+
+/**
+ * samples window of windowWidth lines of blockSize pixels rotated to block orientation
+ * pixel offsets from block center are precomputed once per quantized orientation
+ */
+class OrientedWindowSampler
+{
+private:
+	int blockSize;
+	int windowWidth;
+
+	//offsets of window pixels line by line, built on first use of the orientation bin
+	vector<cv::Point> offsets[ORIENTATION_BINS];
+	cv::Rect offsetBounds[ORIENTATION_BINS];
+
+	const vector<cv::Point>& getOffsets(int orientationBin);
+
+public:
+	OrientedWindowSampler(int blockSize, int windowWidth);
+	void sample(Image* image);
+};
@@ -0,0 +1,73 @@
+#include "PipelineWorkspace.h"
+#include <climits>
+
+
+PipelineWorkspace::PipelineWorkspace()
+{
+}
+
+
+/**
+ * returned matrix is continuous and shares memory with the workspace,
+ * its content is overwritten when the same buffer is acquired again
+ * matrix shares ownership, buffer regrown by later acquire leaves memory of older matrices alive until they are released
+ */
+cv::Mat PipelineWorkspace::acquire(WorkspaceBuffer buffer, int rows, int cols, int type)
+{
+	size_t neededElements = static_cast<size_t>(rows) * cols;
+	CV_Assert(neededElements <= INT_MAX);
+	if (neededElements == 0)
+		return cv::Mat(rows, cols, type);
+
+	cv::Mat& bufferStorage = this->storage[buffer];
+
+	//grow only, smaller images use front part of the buffer
+	if (bufferStorage.type() != type || bufferStorage.total() < neededElements)
+		bufferStorage.create(1, static_cast<int>(neededElements), type);
+
+	return bufferStorage.colRange(0, static_cast<int>(neededElements)).reshape(0, rows);
+}
+
+
+cv::Mat PipelineWorkspace::acquire(WorkspaceBuffer buffer, const cv::Size& size, int type)
+{
+	return acquire(buffer, size.height, size.width, type);
+}
+
+
+//kernel bank slot, create keeps memory when size and type do not change
+cv::Mat& PipelineWorkspace::getKernel(int index, const cv::Size& size, int type)
+{
+	if (index >= this->kernels.size())
+		this->kernels.resize(index + 1);
+
+	this->kernels[index].create(size, type);
+	return this->kernels[index];
+}
+
+
+size_t PipelineWorkspace::getAllocatedBytes()
+{
+	size_t bytes = 0;
+
+	for (int i = 0; i < WORKSPACE_BUFFERS; i++)
+	{
+		bytes += this->storage[i].total() * this->storage[i].elemSize();
+	}
+	for (const cv::Mat& kernel : this->kernels)
+	{
+		bytes += kernel.total() * kernel.elemSize();
+	}
+
+	return bytes;
+}
+
+
+void PipelineWorkspace::release()
+{
+	for (int i = 0; i < WORKSPACE_BUFFERS; i++)
+	{
+		this->storage[i].release();
+	}
+	this->kernels.clear();
+}
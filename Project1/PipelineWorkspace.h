@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+//temporary buffers reused between images
+enum WorkspaceBuffer
+{
+	GRADIENT_X,
+	GRADIENT_Y,
+	TENSOR_INTEGRAL,
+	THETA_X_FULL_SIZE,
+	THETA_Y_FULL_SIZE,
+	SMOOTHED_THETA_X,
+	SMOOTHED_THETA_Y,
+	SMOOTHED_FREQUENCY,
+	QUALITY_CATEGORY_MAP,
+	CLASSIFICATION_MAP,
+	FILTER_SOURCE,
+	FILTER_RESULT,
+	FILTERED_BLOCK,
+	FFT_TILE,
+	WORKSPACE_BUFFERS
+};
+
+/**
+ * buffers of one worker, sized for the largest image processed so far
+ * next image of the same or smaller size gets them without allocation
+ */
+class PipelineWorkspace
+{
+private:
+	cv::Mat storage[WORKSPACE_BUFFERS];
+	std::vector<cv::Mat> kernels;
+
+public:
+	PipelineWorkspace();
+	cv::Mat acquire(WorkspaceBuffer buffer, int rows, int cols, int type);
+	cv::Mat acquire(WorkspaceBuffer buffer, const cv::Size& size, int type);
+	cv::Mat& getKernel(int index, const cv::Size& size, int type);
+	size_t getAllocatedBytes();
+	void release();
+};
@@ -11,9 +11,8 @@ void Preprocessor::normalize(Image* image)
     cv::Mat img = image->getProcessedImage();
 
     cv::Scalar meanSc, devSc;
-    cv::Mat normalizedImage;
-
-    img.copyTo(normalizedImage);
+    //every pixel is written below
+    cv::Mat normalizedImage(img.size(), CV_8U);
 
     //calculace mean value and variance
     meanStdDev(img, meanSc, devSc);
@@ -50,9 +49,9 @@ void Preprocessor::normalize(Image* image)
 
 void Preprocessor::smoothenImage(Image* image, int sigma)
 {
-    cv::Mat img = image->getProcessedImage();
-    GaussianBlur(img, img, cv::Size(3, 3), sigma, sigma, cv::BORDER_DEFAULT);
-    image->setProcessedImage(img);
+    cv::Mat smoothedImage;
+    GaussianBlur(image->getProcessedImage(), smoothedImage, cv::Size(3, 3), sigma, sigma, cv::BORDER_DEFAULT);
+    image->setProcessedImage(smoothedImage);
 }
 
 
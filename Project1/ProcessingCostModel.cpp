@@ -0,0 +1,214 @@
+#include "ProcessingCostModel.h"
+#include "BackgroundSubstractor.h"
+#include "Preprocessor.h"
+#include <opencv2/imgproc.hpp>
+#include <set>
+
+
+/**
+ * linear model of processing time in milliseconds, refined online by recursive least squares
+ * features: bias, megapixels, foreground megapixels, damaged areas, damaged megapixels,
+ * orientation scales generated for damaged areas times megapixels
+ */
+ProcessingCostModel::ProcessingCostModel()
+{
+	//rough initial guess, replaced by measured timings after first images
+	double initialWeights[COST_FEATURES] = { 20., 400., 1500., 5., 200., 300. };
+
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		this->weights[i] = initialWeights[i];
+
+		for (int j = 0; j < COST_FEATURES; j++)
+		{
+			this->covariance[i][j] = (i == j) ? 1000. : 0.;
+		}
+	}
+}
+
+
+ImageCostFeatures ProcessingCostModel::extractFeatures(Image* image)
+{
+	cv::Size size = image->getSize();
+	int blockSize = image->getBlockSize();
+	double megapixels = size.area() / 1e6;
+	double blockMegapixels = blockSize * blockSize / 1e6;
+
+	double foregroundRatio = this->meanForegroundRatio;
+	double damagedAreas = this->meanDamagedAreas;
+	double orientationScales = this->meanOrientationScales;
+
+	//background estimation already done
+	if (!image->getForegroundBlocks().empty())
+	{
+		foregroundRatio = image->getForegroundBlocks().getForegroundRatio();
+	}
+
+	//damaged part of foreground
+	double damagedMegapixels = this->meanDamagedRatio * foregroundRatio * megapixels;
+
+	//damage detection already done
+	if (!image->getQualityMap().empty())
+	{
+		const vector<ImageArea>& areas = image->getHighlyDamagedAreas();
+		set<int> sizeRanges;
+
+		damagedAreas = static_cast<double>(areas.size());
+		damagedMegapixels = 0;
+
+		for (const ImageArea& area : areas)
+		{
+			damagedMegapixels += area.getPointsNumber() * blockMegapixels;
+
+			//one custom orientation field is generated per range of two sizes
+			int smallerDimension = area.getMinDimension();
+			if (smallerDimension >= 1)
+				sizeRanges.insert((smallerDimension - 1) / 2);
+		}
+		orientationScales = static_cast<double>(sizeRanges.size());
+	}
+
+	ImageCostFeatures features{ {
+		1.,
+		megapixels,
+		foregroundRatio * megapixels,
+		damagedAreas,
+		damagedMegapixels,
+		orientationScales * megapixels
+	} };
+
+	return features;
+}
+
+
+/**
+ * foreground ratio is measured after the same preprocessing as in pipeline, so it comes from
+ * the same distribution the model is trained on, preprocessing runs on downscaled copy to stay cheap
+ */
+ImageCostFeatures ProcessingCostModel::extractFeaturesBeforeProcessing(const cv::Mat& srcImage)
+{
+	cv::Mat smallImage = srcImage;
+	if (srcImage.cols > COST_PREPASS_WIDTH)
+	{
+		double scale = static_cast<double>(COST_PREPASS_WIDTH) / srcImage.cols;
+		cv::resize(srcImage, smallImage, cv::Size(), scale, scale, cv::INTER_AREA);
+	}
+
+	Image image(smallImage);
+	auto preproc = Preprocessor();
+	preproc.equalize(&image);
+	preproc.smoothenImage(&image, 1);
+	preproc.normalize(&image);
+
+	auto bSubstractor = BackgroundSubstractor();
+	bSubstractor.estimateBackgroundAreaFromVariance(&image);
+
+	ImageCostFeatures features = extractFeatures(&image);
+
+	//all features except bias and number of damaged areas are proportional to image area,
+	//source would be cropped to multiple of its block size by pipeline
+	int blockSize = Image::getDefaultBlockSize(srcImage.cols);
+	cv::Size croppedSize(srcImage.cols / blockSize * blockSize, srcImage.rows / blockSize * blockSize);
+	double areaRatio = static_cast<double>(croppedSize.area()) / image.getSize().area();
+	features.values[1] *= areaRatio;
+	features.values[2] *= areaRatio;
+	features.values[4] *= areaRatio;
+	features.values[5] *= areaRatio;
+
+	return features;
+}
+
+
+double ProcessingCostModel::predict(const ImageCostFeatures& features)
+{
+	double prediction = 0.;
+
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		prediction += this->weights[i] * features.values[i];
+	}
+
+	return (prediction > 0.) ? prediction : 0.;
+}
+
+
+double ProcessingCostModel::predict(Image* image)
+{
+	return predict(extractFeatures(image));
+}
+
+
+void ProcessingCostModel::update(const ImageCostFeatures& features, double measuredMs)
+{
+	const double* x = features.values;
+	double px[COST_FEATURES];
+	double denominator = this->forgettingFactor;
+
+	//P * x and x' * P * x
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		px[i] = 0.;
+		for (int j = 0; j < COST_FEATURES; j++)
+		{
+			px[i] += this->covariance[i][j] * x[j];
+		}
+		denominator += x[i] * px[i];
+	}
+
+	double error = measuredMs - predict(features);
+
+	//gain vector, update weights and covariance
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		this->weights[i] += px[i] / denominator * error;
+	}
+
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		for (int j = 0; j < COST_FEATURES; j++)
+		{
+			this->covariance[i][j] = (this->covariance[i][j] - px[i] * px[j] / denominator) / this->forgettingFactor;
+		}
+	}
+
+	//running means of features that are not known before processing
+	this->measurements++;
+	double megapixels = x[1];
+	double alpha = 1. / (this->measurements < 20 ? this->measurements : 20);
+
+	if (megapixels > 0)
+	{
+		this->meanForegroundRatio += alpha * (x[2] / megapixels - this->meanForegroundRatio);
+		this->meanOrientationScales += alpha * (x[5] / megapixels - this->meanOrientationScales);
+	}
+	if (x[2] > 0)
+	{
+		this->meanDamagedRatio += alpha * (x[4] / x[2] - this->meanDamagedRatio);
+	}
+	this->meanDamagedAreas += alpha * (x[3] - this->meanDamagedAreas);
+}
+
+
+/**
+ * model is linear, so forecast of summed features of all images is the sum of their forecasts
+ * caller keeps the sum and removes features of finished images in constant time
+ */
+double ProcessingCostModel::forecastBatch(const ImageCostFeatures& batchFeatures)
+{
+	return predict(batchFeatures);
+}
+
+
+void ProcessingCostModel::addFeatures(ImageCostFeatures* sum, const ImageCostFeatures& features, double sign)
+{
+	for (int i = 0; i < COST_FEATURES; i++)
+	{
+		sum->values[i] += sign * features.values[i];
+	}
+}
+
+
+int ProcessingCostModel::getMeasurementsCount()
+{
+	return this->measurements;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Image.h"
+
+#define COST_FEATURES 6
+
+//images wider than this are downscaled before background is estimated for the forecast
+#define COST_PREPASS_WIDTH 1024
+
+//features of one image, all of them cheap to get before the heavy stages run
+typedef struct ImageCostFeatures {
+	double values[COST_FEATURES];
+}ImageCostFeatures;
+
+class ProcessingCostModel
+{
+private:
+	double weights[COST_FEATURES];
+	double covariance[COST_FEATURES][COST_FEATURES];
+	double forgettingFactor = 0.98;
+
+	//running means used while the feature is not known for an image yet
+	double meanForegroundRatio = 0.6;
+	double meanDamagedAreas = 2;
+	double meanDamagedRatio = 0.05;
+	double meanOrientationScales = 3;
+	int measurements = 0;
+
+public:
+	ProcessingCostModel();
+	ImageCostFeatures extractFeatures(Image* image);
+	ImageCostFeatures extractFeaturesBeforeProcessing(const cv::Mat& srcImage);
+	double predict(const ImageCostFeatures& features);
+	double predict(Image* image);
+	void update(const ImageCostFeatures& features, double measuredMs);
+	double forecastBatch(const ImageCostFeatures& batchFeatures);
+	static void addFeatures(ImageCostFeatures* sum, const ImageCostFeatures& features, double sign);
+	int getMeasurementsCount();
+};
@@ -1,47 +1,344 @@
 #include "ProcessingPipeline.h"
 #include "SingularityDetector.h"
 #include "HighDamageDetector.h"
+#include "BlockFeatureExtractor.h"
+#include "OrientedWindowSampler.h"
+#include "SpectralEstimator.h"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <fstream>
 
 ProcessingPipeline::ProcessingPipeline() {
 }
 
 
-void ProcessingPipeline::processImage(Image* image)
+//steps are shown only for images processed one by one, batches would block on every image
+void ProcessingPipeline::processImage(Image* image, bool showSteps)
 {
-	auto preproc = new Preprocessor();
-	preproc->equalize(image);
-	preproc->smoothenImage(image, 1);
-	preproc->normalize(image);
+	int64 startTicks = cv::getTickCount();
 
-	auto bSubstractor = new BackgroundSubstractor();
-	bSubstractor->estimateBackgroundAreaFromVariance(image);
+	//temporary buffers are shared with previous images of this pipeline
+	image->setWorkspace(&this->workspace);
 
-	auto oEstimator = new OrientationsEstimator();
-	oEstimator->computeOrientationField(image);
-	oEstimator->smoothenOrientationField(oEstimator->getThetaX(), oEstimator->getThetaY(), image);
+	preprocess(image);
+	reconstruct(image);
 
-	auto fEstimator = new FrequencyEstimator();
-	fEstimator->computeFrequencyField(image);
-	fEstimator->smoothenFrequencyField(image);
+	//refine cost model with measured time
+	double elapsedMs = (cv::getTickCount() - startTicks) * 1000. / cv::getTickFrequency();
+	this->costModel.update(this->costModel.extractFeatures(image), elapsedMs);
+	
+	if (DEBUG && showSteps) showProcessSteps(image);
+}
+
+
+/**
+ * large images are processed in tiles with halo of whole blocks around them
+ * only stages with full resolution floating point temporaries run per tile, that is block feature
+ * extraction and gabor filtering, halo covers pixels their kernels read around a block
+ * preprocessing and all block level stages run on whole image, so fields and damaged areas
+ * do not depend on tile borders, memory stays bounded only with block level smoothing
+ */
+void ProcessingPipeline::processImageTiled(Image* image, int tileBlocks, int haloBlocks, bool showSteps)
+{
+	int64 startTicks = cv::getTickCount();
+
+	image->setWorkspace(&this->workspace);
+	preprocess(image);
+
+	cv::Mat preprocessedImage = image->getProcessedImage();
+	int blockSize = image->getBlockSize();
+	cv::Size blocks(preprocessedImage.cols / blockSize, preprocessedImage.rows / blockSize);
+	vector<cv::Rect> cores = getTileCores(blocks, tileBlocks);
+
+	//block features of tiles are stitched, pixel gradients exist only for one tile at a time
+	BlockStatistics statistics;
+	BlockGrid<double>* grids[] = { &statistics.mean, &statistics.variance, &statistics.gxx, &statistics.gyy, &statistics.gxy };
+	for (BlockGrid<double>* grid : grids)
+		*grid = BlockGrid<double>(blocks.width, blocks.height, 0.);
+
+	for (const cv::Rect& core : cores)
+	{
+		cv::Rect tile = getTileWithHalo(core, haloBlocks, blocks);
+		Image tileImage(preprocessedImage(cv::Rect(tile.tl() * blockSize, tile.size() * blockSize)).clone(), blockSize);
+		tileImage.setWorkspace(&this->workspace);
+
+		auto featureExtractor = BlockFeatureExtractor();
+		featureExtractor.extract(&tileImage);
+		stitchBlockStatistics(tileImage.getBlockStatistics(), cv::Rect(core.tl() - tile.tl(), core.size()), core.tl(), &statistics);
+	}
+
+	image->setBlockStatistics(std::move(statistics));
+	image->setGradientField(BlockFeatureExtractor::getBlockTensorIntegral(image->getBlockStatistics(), blockSize));
+
+	estimateFields(image);
+
+	//gabor bank is built from fields of whole image, so neighboring tiles use the same kernels
+	cv::Mat resultImage(preprocessedImage.size(), CV_8U, cv::Scalar(0));
+
+	for (const cv::Rect& core : cores)
+	{
+		cv::Rect tile = getTileWithHalo(core, haloBlocks, blocks);
+		Image tileImage(preprocessedImage(cv::Rect(tile.tl() * blockSize, tile.size() * blockSize)).clone(), blockSize);
+		tileImage.setWorkspace(&this->workspace);
+		setTileFields(image, tile, &tileImage);
+
+		enhance(&tileImage, image);
+
+		cv::Rect coreInTile(core.tl() - tile.tl(), core.size());
+		tileImage.getProcessedImage()(cv::Rect(coreInTile.tl() * blockSize, coreInTile.size() * blockSize))
+			.copyTo(resultImage(cv::Rect(core.tl() * blockSize, core.size() * blockSize)));
+	}
+
+	image->setProcessedImage(resultImage);
+
+	//refine cost model with measured time
+	double elapsedMs = (cv::getTickCount() - startTicks) * 1000. / cv::getTickFrequency();
+	this->costModel.update(this->costModel.extractFeatures(image), elapsedMs);
+
+	if (DEBUG && showSteps) showProcessSteps(image);
+}
+
+
+//cores of the same size cover all blocks, so no thin tile is left at the image border
+vector<cv::Rect> ProcessingPipeline::getTileCores(const cv::Size& blocks, int tileBlocks)
+{
+	int tilesX = (blocks.width + tileBlocks - 1) / tileBlocks;
+	int tilesY = (blocks.height + tileBlocks - 1) / tileBlocks;
+	int coreWidth = (blocks.width + tilesX - 1) / tilesX;
+	int coreHeight = (blocks.height + tilesY - 1) / tilesY;
+	vector<cv::Rect> cores;
+
+	for (int tileY = 0; tileY < tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < tilesX; tileX++)
+		{
+			cv::Rect core = cv::Rect(tileX * coreWidth, tileY * coreHeight, coreWidth, coreHeight) & cv::Rect(cv::Point(0, 0), blocks);
+			if (!core.empty())
+				cores.push_back(core);
+		}
+	}
 
-	auto damageDetector = new DamageDetector();
-	damageDetector->setup(image);
-	damageDetector->detectDamagedAreas();
+	return cores;
+}
+
+
+cv::Rect ProcessingPipeline::getTileWithHalo(const cv::Rect& core, int haloBlocks, const cv::Size& blocks)
+{
+	cv::Rect tile(core.x - haloBlocks, core.y - haloBlocks, core.width + 2 * haloBlocks, core.height + 2 * haloBlocks);
+	return tile & cv::Rect(cv::Point(0, 0), blocks);
+}
+
+
+void ProcessingPipeline::preprocess(Image* image)
+{
+	auto preproc = Preprocessor();
+	preproc.equalize(image);
+	preproc.smoothenImage(image, 1);
+	preproc.normalize(image);
+}
+
+
+//all stages after preprocessing
+void ProcessingPipeline::reconstruct(Image* image)
+{
+	auto featureExtractor = BlockFeatureExtractor();
+	featureExtractor.extract(image);
 
-	auto singularityDetector = new SingularityDetector();
-	singularityDetector->findSingularities(image);
-	singularityDetector->markDamageAreasThatContainCoreOrDelta(image);
+	estimateFields(image);
+	enhance(image, image);
+}
+
+
+//stages working with block features, oriented windows of 8-bit image and block fields
+void ProcessingPipeline::estimateFields(Image* image)
+{
+	auto bSubstractor = BackgroundSubstractor();
+	bSubstractor.estimateBackgroundAreaFromVariance(image);
+
+	auto oEstimator = OrientationsEstimator();
+	auto fEstimator = FrequencyEstimator();
+
+#if SPECTRAL_ESTIMATION
+	auto sEstimator = SpectralEstimator();
+	sEstimator.computeFields(image);
+	oEstimator.smoothenOrientationField(image->thetaX, image->thetaY, image);
+	fEstimator.smoothenFrequencyField(image);
+#else
+	oEstimator.computeOrientationField(image);
+	oEstimator.smoothenOrientationField(oEstimator.getThetaX(), oEstimator.getThetaY(), image);
+
+	//oriented windows for frequency and ridge clarity are sampled once
+	OrientedWindowSampler windowSampler(image->getBlockSize(), image->getWindowWidth());
+	windowSampler.sample(image);
+
+	fEstimator.computeFrequencyField(image);
+	fEstimator.smoothenFrequencyField(image);
+#endif
+
+	auto damageDetector = DamageDetector();
+	damageDetector.setup(image);
+	damageDetector.detectDamagedAreas();
+
+	auto singularityDetector = SingularityDetector();
+	singularityDetector.findSingularities(image);
+	singularityDetector.markDamageAreasThatContainCoreOrDelta(image);
+
+	oEstimator.updateOrientationsBasedOnDamage(image);
+	oEstimator.smoothenOrientationField(image->thetaX, image->thetaY, image);
+}
 
-	oEstimator->updateOrientationsBasedOnDamage(image);
-	oEstimator->smoothenOrientationField(image->thetaX, image->thetaY, image);
 
-	auto gaborFilter = new GaborFilter();
-	gaborFilter->setup(image);
-	gaborFilter->filter();
-	cv::Mat filteredImage = gaborFilter->getResultImage();
+//gabor filtering with bank spanning fields of fieldsImage, the image itself or whole image of a tile
+void ProcessingPipeline::enhance(Image* image, Image* fieldsImage)
+{
+	auto gaborFilter = GaborFilter();
+	gaborFilter.setup(image, fieldsImage);
+	gaborFilter.filter();
+	cv::Mat filteredImage = gaborFilter.getResultImage();
 	image->setProcessedImage(filteredImage);
-	
-	if(DEBUG) showProcessSteps(image);
+}
+
+
+//gabor filter of tile reads only these fields, halo blocks keep their values from whole image
+void ProcessingPipeline::setTileFields(Image* image, const cv::Rect& tile, Image* tileImage)
+{
+	cv::Mat backgroundMask = image->getBackgroundMask()(tile).clone();
+	tileImage->setBackgroundMask(backgroundMask);
+	tileImage->setForegroundBlocks(ForegroundBlockIndex(backgroundMask));
+	tileImage->setOrientationField(image->getOrientationField()(tile).clone());
+	tileImage->setFrequencyField(image->getFrequencyField()(tile).clone());
+	tileImage->setQualityMap(image->getQualityMap()(tile).clone());
+}
+
+
+//copies core blocks of tile statistics to statistics of whole image
+void ProcessingPipeline::stitchBlockStatistics(const BlockStatistics& tileStatistics, const cv::Rect& coreInTile,
+	const cv::Point& coreInImage, BlockStatistics* statistics)
+{
+	const BlockGrid<double>* tileGrids[] = { &tileStatistics.mean, &tileStatistics.variance, &tileStatistics.gxx, &tileStatistics.gyy, &tileStatistics.gxy };
+	BlockGrid<double>* imageGrids[] = { &statistics->mean, &statistics->variance, &statistics->gxx, &statistics->gyy, &statistics->gxy };
+
+	for (int i = 0; i < sizeof(tileGrids) / sizeof(tileGrids[0]); i++)
+	{
+		tileGrids[i]->getMat()(coreInTile).copyTo(imageGrids[i]->getMat()(cv::Rect(coreInImage, coreInTile.size())));
+	}
+}
+
+
+void ProcessingPipeline::processBatch(const vector<string>& imagePaths)
+{
+	vector<ImageCostFeatures> features(imagePaths.size());
+	vector<pair<double, int>> schedule;
+	ImageCostFeatures remainingFeatures{};
+
+	for (int i = 0; i < imagePaths.size(); i++)
+	{
+		cv::Mat srcImage = cv::imread(imagePaths.at(i), cv::IMREAD_GRAYSCALE);
+		if (srcImage.empty())
+			continue;
+
+		features.at(i) = this->costModel.extractFeaturesBeforeProcessing(srcImage);
+		schedule.push_back(make_pair(this->costModel.predict(features.at(i)), i));
+		ProcessingCostModel::addFeatures(&remainingFeatures, features.at(i), 1.);
+	}
+
+	//longest jobs first
+	sort(schedule.begin(), schedule.end(), [](const pair<double, int>& a, const pair<double, int>& b) {
+		return a.first > b.first;
+	});
+
+	for (int job = 0; job < schedule.size(); job++)
+	{
+		int sourceIndex = schedule.at(job).second;
+
+		//forecast with model refined by already processed images
+		cout << "remaining batch time forecast: " << this->costModel.forecastBatch(remainingFeatures) << " ms" << endl;
+		ProcessingCostModel::addFeatures(&remainingFeatures, features.at(sourceIndex), -1.);
+
+		try {
+			cv::Mat srcImage = cv::imread(imagePaths.at(sourceIndex), cv::IMREAD_GRAYSCALE);
+			if (srcImage.empty())
+			{
+				cout << "cannot read image " << imagePaths.at(sourceIndex) << endl;
+				continue;
+			}
+
+			Image image(srcImage);
+			processImageAnySize(&image, sourceIndex);
+		}
+		catch (...)
+		{
+			cout << "processing of image " << sourceIndex << " failed" << endl;
+		}
+	}
+}
+
+
+/**
+ * images of pack are processed in stored order, pixels are used directly from the mapping
+ * next image is prefetched while current one is processed
+ */
+void ProcessingPipeline::processPack(const ImagePack& pack)
+{
+	pack.prefetch(0);
+
+	for (int i = 0; i < pack.getImageCount(); i++)
+	{
+		pack.prefetch(i + 1);
+
+		try {
+			Image image(pack.getImage(i));
+			processImageAnySize(&image, i);
+		}
+		catch (...)
+		{
+			cout << "processing of image " << i << " failed" << endl;
+		}
+	}
+}
+
+
+//full resolution temporaries of very large images would not fit into memory at once
+void ProcessingPipeline::processImageAnySize(Image* image, int sourceIndex)
+{
+	if (image->getSize().area() > MAX_UNTILED_PIXELS)
+	{
+		//halo covers the farthest pixel read around a block by tiled stages, gradients or gabor kernel
+		//core follows the pixel budget of a tile, but stays several halos wide for very large blocks
+		int blockSize = image->getBlockSize();
+		int haloBlocks = cvCeil(static_cast<double>(std::max(TILE_GRADIENT_RADIUS, GaborFilter::getMaxKernelRadius())) / blockSize);
+		int tileBlocks = std::max(TILE_PIXELS / blockSize - 2 * haloBlocks, TILE_MIN_CORE_HALOS * haloBlocks);
+
+		processImageTiled(image, tileBlocks, haloBlocks, false);
+	}
+	else
+		processImage(image, false);
+
+	//fields for downstream tools, one record per image
+	if (!this->fieldBundlePath.empty() && !FieldBundle::write(this->fieldBundlePath, image, sourceIndex, true))
+		cout << "cannot write field bundle record of image " << sourceIndex << endl;
+}
+
+
+ProcessingCostModel* ProcessingPipeline::getCostModel()
+{
+	return &this->costModel;
+}
+
+
+PipelineWorkspace* ProcessingPipeline::getWorkspace()
+{
+	return &this->workspace;
+}
+
+
+//records of all images processed by batch are appended to file, existing file is replaced
+void ProcessingPipeline::setFieldBundleOutput(const string& path)
+{
+	this->fieldBundlePath = path;
+
+	if (!path.empty())
+		ofstream(path, ios::binary | ios::trunc);
 }
 
 
@@ -8,11 +8,48 @@
 #include "DamageDetector.h"
 #include "GaborFilter.h"
 #include "Image.h"
+#include "ProcessingCostModel.h"
+#include "PipelineWorkspace.h"
+#include "ImagePack.h"
+#include "FieldBundle.h"
+
+//orientation and frequency estimated together from block spectra instead of gradients and x-signatures
+#define SPECTRAL_ESTIMATION 0
+
+//side of tile including halo in pixels, images larger than one tile are processed in tiles
+#define TILE_PIXELS 2048
+#define MAX_UNTILED_PIXELS (TILE_PIXELS * TILE_PIXELS)
+//pixels read around a block by scharr gradients of block feature extraction
+#define TILE_GRADIENT_RADIUS 1
+//tile core is at least this many halos wide, so work repeated in halos stays bounded
+#define TILE_MIN_CORE_HALOS 4
 
 class ProcessingPipeline {
+private:
+	ProcessingCostModel costModel;
+	PipelineWorkspace workspace;
+	string fieldBundlePath;
+
+	void preprocess(Image* image);
+	void reconstruct(Image* image);
+	void estimateFields(Image* image);
+	void enhance(Image* image, Image* fieldsImage);
+	void setTileFields(Image* image, const cv::Rect& tile, Image* tileImage);
+	void stitchBlockStatistics(const BlockStatistics& tileStatistics, const cv::Rect& coreInTile,
+		const cv::Point& coreInImage, BlockStatistics* statistics);
+	static vector<cv::Rect> getTileCores(const cv::Size& blocks, int tileBlocks);
+	static cv::Rect getTileWithHalo(const cv::Rect& core, int haloBlocks, const cv::Size& blocks);
+
 public:
 	ProcessingPipeline();
     void showProcessSteps(Image* image);
-    void processImage(Image* image);
+    void processImage(Image* image, bool showSteps = true);
+	void processImageTiled(Image* image, int tileBlocks, int haloBlocks, bool showSteps = true);
+	void processImageAnySize(Image* image, int sourceIndex);
+	void processBatch(const vector<string>& imagePaths);
+	void processPack(const ImagePack& pack);
+	ProcessingCostModel* getCostModel();
+	PipelineWorkspace* getWorkspace();
+	void setFieldBundleOutput(const string& path);
 };
 
@@ -1,6 +1,6 @@
 #include "RidgeClarityEstimator.h"
 #include "BackgroundSubstractor.h"
-#include "Preprocessor.h"
+#include "OrientedWindowSampler.h"
 
 
 RidgeClarityEstimator::RidgeClarityEstimator() {
@@ -9,78 +9,44 @@ RidgeClarityEstimator::RidgeClarityEstimator() {
 
 cv::Mat RidgeClarityEstimator::computeRidgeClarity(Image* image)
 {
-	cv::Mat binarizedImg = Preprocessor::binarize(image);
-	cv::Mat orientationField = image->getOrientationField();
 	cv::Mat backgroundMask = image->getBackgroundMask();
     int blockSize = image->getBlockSize();
 	int windowWidth = image->getWindowWidth();
 
-	cv::Mat ridgeClarityMap = cv::Mat::zeros(binarizedImg.rows / blockSize, binarizedImg.cols / blockSize, CV_8U);
-
-	for (int blockX = 0; blockX < ridgeClarityMap.cols; blockX++) {
-		for (int blockY = 0; blockY < ridgeClarityMap.rows; blockY++) {
-			//skip background areas
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask)) {
-				ridgeClarityMap.at<unsigned char>(blockY, blockX) = BACKGROUND;
-				continue;
-			}
-
-			vector<double> avgIntensitiesInLine(windowWidth, 0.0);
-
-			int blockCenterPixelX = static_cast<int>(blockX * blockSize + (blockSize - 1) / 2);
-			int blockCenterPixelY = static_cast<int>(blockY * blockSize + (blockSize - 1) / 2);
-
-			double orientationRad = image->getOrientationField().at<double>(blockY, blockX) * CV_PI / 180.0;
+	//lines of binarized image are sampled together with x-signatures for frequency
+	if (image->getOrientedSignatures().binarized.empty()) {
+		OrientedWindowSampler(blockSize, windowWidth).sample(image);
+	}
+	const cv::Mat& signatures = image->getOrientedSignatures().binarized;
 
-			double cosine = cos(orientationRad);
-			double sine = sin(orientationRad);
+	//background areas are skipped
+	cv::Mat ridgeClarityMap(backgroundMask.rows, backgroundMask.cols, CV_8U, cv::Scalar(BACKGROUND));
 
-			for (int lineIndex = 0; lineIndex < windowWidth; lineIndex++) {
-				//pixels withing the image area                
-				int validValuesOfIntensity = 0;
+	for (const cv::Point& foregroundBlock : image->getForegroundBlocks().getBlocks()) {
+		int blockX = foregroundBlock.x;
+		int blockY = foregroundBlock.y;
 
-				//iterate over pixels in one line according to the window field
-				for (int linePixelIndex = 0; linePixelIndex < blockSize; linePixelIndex++) {
-					//calculating coordinates of next pixel in line according to ridge line field 
-					int linePixelX = static_cast<int>(
-						blockCenterPixelX + (linePixelIndex - blockSize / 2) * cosine +
-						(lineIndex - windowWidth / 2) * sine);
-					int linePixelY = static_cast<int>(
-						blockCenterPixelY + (linePixelIndex - blockSize / 2) * sine +
-						(windowWidth / 2 - lineIndex) * cosine);
+		const double* blockLines = signatures.ptr<double>(blockY * backgroundMask.cols + blockX);
+		vector<double> avgIntensitiesInLine(blockLines, blockLines + windowWidth);
 
-					//adding value to Sum of intensities of pixels in line
-					if (Image::isElementInMatSizeRange(linePixelX, linePixelY, binarizedImg)) {
-						//add only if pixel belongs to the processedImage area
-						avgIntensitiesInLine[lineIndex] += (double)binarizedImg.at<unsigned char>(linePixelY, linePixelX);
-						validValuesOfIntensity++;
-					}
-				}
-				//finishing calculation of one particular line average intensity	
-				if (validValuesOfIntensity != 0) {
-					avgIntensitiesInLine[lineIndex] = avgIntensitiesInLine[lineIndex] / validValuesOfIntensity;
-				}
-			}
-
-            //how many lines in one block have stable value of gray intensity = low variance
-			int goodClarityLinesPerBlock = windowWidth;
-            for(int index = 0; index < avgIntensitiesInLine.size(); index++)
+        //how many lines in one block have stable value of gray intensity = low variance
+		int goodClarityLinesPerBlock = windowWidth;
+        for(int index = 0; index < avgIntensitiesInLine.size(); index++)
+        {
+            if(avgIntensitiesInLine.at(index) > 50 && avgIntensitiesInLine.at(index) < 200)
             {
-                if(avgIntensitiesInLine.at(index) > 50 && avgIntensitiesInLine.at(index) < 200)
-                {
-					goodClarityLinesPerBlock--;
-                }
+				goodClarityLinesPerBlock--;
             }
+        }
 
-            //at least half of lines per block have to have good clarity --> low variance in intensity
-            if(goodClarityLinesPerBlock > windowWidth * 0.5)
-            {
-				ridgeClarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
-            }
-			else
-			{
-				ridgeClarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
-			}
+        //at least half of lines per block have to have good clarity --> low variance in intensity
+        if(goodClarityLinesPerBlock > windowWidth * 0.5)
+        {
+			ridgeClarityMap.at<unsigned char>(blockY, blockX) = HIGH_CLARITY;
+        }
+		else
+		{
+			ridgeClarityMap.at<unsigned char>(blockY, blockX) = LOW_CLARITY;
 		}
 	}
 
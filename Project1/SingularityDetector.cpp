@@ -18,49 +18,49 @@ void SingularityDetector::estimatePoincareIndex(Image* image)
 {
 	int blockSize = image->getBlockSize();
 	cv::Mat orientationField = image->getOrientationField();
-	cv::Mat poincareIndexMap = cv::Mat::zeros(orientationField.size(), CV_64F);
+	cv::Mat backgroundMask = image->getBackgroundMask();
+	BlockGrid<double> poincareIndexMap(orientationField.cols, orientationField.rows, 0.);
+	BlockGrid<unsigned char> background(backgroundMask);
 
-	for (int blockX = 0; blockX < orientationField.cols; blockX++)
+	for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
 	{
-		for (int blockY = 0; blockY < orientationField.rows; blockY++)
-		{
-			if (BackgroundSubstractor::isBackgroundBlock(blockX, blockY, image->getBackgroundMask()))
-				continue;
-			if (Image::isElementBorderElementOfMat(blockX, blockY, orientationField))
-				continue;
-			if(BackgroundSubstractor::hasBackgroundNeighbor(blockX, blockY, image->getBackgroundMask()))
-			{
-				continue;
-			}
+		int blockX = block.x;
+		int blockY = block.y;
 
-			vector<cv::Point> surroundingPoints = getSurroundingPointsInDefinedOrder(blockX, blockY);
-			vector<double> surroundingOrientations = getOrientationsAtPointsInRadians(surroundingPoints, orientationField);
+		if (poincareIndexMap.isBorder(blockX, blockY))
+			continue;
+		if(background.countInNeighborhood(blockX, blockY, BACKGROUND) > 0)
+		{
+			continue;
+		}
 
-			double sumBeta = 0.;
+		vector<cv::Point> surroundingPoints = getSurroundingPointsInDefinedOrder(blockX, blockY);
+		vector<double> surroundingOrientations = getOrientationsAtPointsInRadians(surroundingPoints, orientationField);
 
-			for (int i = 0; i < surroundingOrientations.size(); i++)
-			{
-				double beta;
-				double orientationChange = abs(surroundingOrientations.at(i) - surroundingOrientations.at((i + 1) % 8));
+		double sumBeta = 0.;
 
-				if (orientationChange <= -(CV_PI / 2.))
-					beta = orientationChange + CV_PI;
-				else if (orientationChange > (-CV_PI / 2.) && orientationChange <= (CV_PI / 2.))
-					beta = orientationChange;
-				else
-					beta = orientationChange - CV_PI;
+		for (int i = 0; i < surroundingOrientations.size(); i++)
+		{
+			double beta;
+			double orientationChange = abs(surroundingOrientations.at(i) - surroundingOrientations.at((i + 1) % 8));
 
-				sumBeta += beta;
-			}
+			if (orientationChange <= -(CV_PI / 2.))
+				beta = orientationChange + CV_PI;
+			else if (orientationChange > (-CV_PI / 2.) && orientationChange <= (CV_PI / 2.))
+				beta = orientationChange;
+			else
+				beta = orientationChange - CV_PI;
 
-			double poincareIndex = 1 / CV_PI * sumBeta;
-			poincareIndexMap.at<double>(blockY, blockX) = poincareIndex;
+			sumBeta += beta;
 		}
+
+		double poincareIndex = 1 / CV_PI * sumBeta;
+		poincareIndexMap(blockX, blockY) = poincareIndex;
 	}
 
-	cv::Mat coresAndDeltas = markCoresAndDeltas(poincareIndexMap);
+	cv::Mat coresAndDeltas = markCoresAndDeltas(poincareIndexMap.getMat());
 	
-	eliminateFalseCoresAndDeltas(&coresAndDeltas, image->getBackgroundMask());
+	eliminateFalseCoresAndDeltas(&coresAndDeltas, backgroundMask);
 
 	image->setSingularityMap(coresAndDeltas);
 }
@@ -68,38 +68,43 @@ void SingularityDetector::estimatePoincareIndex(Image* image)
 
 cv::Mat SingularityDetector::markCoresAndDeltas(const cv::Mat& poincareIndexMap)
 {
-	cv::Mat coresAndDeltas = cv::Mat::zeros(poincareIndexMap.size(), CV_32S);
+	BlockGrid<int> coresAndDeltas(poincareIndexMap.cols, poincareIndexMap.rows, 0);
+	BlockGrid<double> poincareIndexes(poincareIndexMap);
 
-	for (int i = 0; i < coresAndDeltas.cols; i++)
+	for (int j = 0; j < coresAndDeltas.getHeight(); j++)
 	{
-		for (int j = 0; j < coresAndDeltas.rows; j++)
+		for (int i = 0; i < coresAndDeltas.getWidth(); i++)
 		{
-			if (poincareIndexMap.at<double>(j, i) > -1 &&
-				poincareIndexMap.at<double>(j, i) < -0.5)
+			double poincareIndex = poincareIndexes(i, j);
+
+			if (poincareIndex > -1 && poincareIndex < -0.5)
 			{
-				coresAndDeltas.at<int>(j, i) = CORE_OR_DELTA;
+				coresAndDeltas(i, j) = CORE_OR_DELTA;
 			}
-			if (poincareIndexMap.at<double>(j, i) > 0.5 &&
-				poincareIndexMap.at<double>(j, i) < 1)
+			if (poincareIndex > 0.5 && poincareIndex < 1)
 			{
-				coresAndDeltas.at<int>(j, i) = CORE_OR_DELTA;
+				coresAndDeltas(i, j) = CORE_OR_DELTA;
 			}
 		}
 	}
 
-	return coresAndDeltas;
+	return coresAndDeltas.getMat();
 }
 
 
 void SingularityDetector::eliminateFalseCoresAndDeltas(cv::Mat* coresAndDeltas, const cv::Mat& backgroundMask)
 {		
-	for(int blockX = 0; blockX < coresAndDeltas->cols; blockX++)
+	BlockGrid<int> singularities(*coresAndDeltas);
+	BlockGrid<unsigned char> background(backgroundMask);
+
+	//map is updated in place, blocks are visited column by column
+	for(int blockX = 0; blockX < singularities.getWidth(); blockX++)
 	{
-		for(int blockY = 0; blockY < coresAndDeltas->rows; blockY++)
+		for(int blockY = 0; blockY < singularities.getHeight(); blockY++)
 		{
-			if (Image::isElementBorderElementOfMat(blockX, blockY, backgroundMask))
+			if (background.isBorder(blockX, blockY))
 				continue;
-			if(BackgroundSubstractor::isBackgroundBlock(blockX, blockY, backgroundMask))
+			if(background(blockX, blockY) == BACKGROUND)
 				continue;
 
 			vector<cv::Point> surroundingPoints = getSurroundingPointsInDefinedOrder(blockX, blockY);
@@ -112,11 +117,11 @@ void SingularityDetector::eliminateFalseCoresAndDeltas(cv::Mat* coresAndDeltas,
 			//count singularity blocks in neigh
 			for (cv::Point point : surroundingPoints)
 			{
-				if (coresAndDeltas->at<int>(point.y, point.x) == CORE_OR_DELTA) {
+				if (singularities(point) == CORE_OR_DELTA) {
 					singularityPointsInNeigh.push_back(point);
 					cores++;
 				}
-				else if (coresAndDeltas->at<int>(point.y, point.x) == CORE_OR_DELTA) {
+				else if (singularities(point) == CORE_OR_DELTA) {
 					singularityPointsInNeigh.push_back(point);
 					deltas++;
 				}
@@ -126,14 +131,14 @@ void SingularityDetector::eliminateFalseCoresAndDeltas(cv::Mat* coresAndDeltas,
 			if (singularityPointsInNeigh.size() > 3)
 			{
 				if (cores > deltas)
-					coresAndDeltas->at<int>(blockY, blockX) = CORE_OR_DELTA;
+					singularities(blockX, blockY) = CORE_OR_DELTA;
 				else
-					coresAndDeltas->at<int>(blockY, blockX) = CORE_OR_DELTA;
+					singularities(blockX, blockY) = CORE_OR_DELTA;
 			}
 			//little singularity blocks in neight >> is not singularity 
 			else
 			{
-				coresAndDeltas->at<int>(blockY, blockX) = 0;
+				singularities(blockX, blockY) = 0;
 			}
 		}
 	}
@@ -161,11 +166,11 @@ vector<double> SingularityDetector::getOrientationsAtPointsInRadians(const vecto
 	const cv::Mat orientationsMap)
 {
 	vector<double> orientations;
-	for (cv::Point point : points)
+	BlockGrid<double> orientationField(orientationsMap);
+
+	for (const cv::Point& point : points)
 	{
-		orientations.push_back(
-			BasicOperations::DegToRad(
-				orientationsMap.at<double>(point.y, point.x)));
+		orientations.push_back(BasicOperations::DegToRad(orientationField(point)));
 	}
 	return orientations;
 }
@@ -173,14 +178,14 @@ vector<double> SingularityDetector::getOrientationsAtPointsInRadians(const vecto
 void SingularityDetector::markDamageAreasThatContainCoreOrDelta(Image* image)
 {
 	vector<ImageArea> areas = image->getHighlyDamagedAreas();
-	cv::Mat singularityMap = image->getSingularityMap();
+	const cv::Mat& singularityMap = image->getSingularityMap();
 	if (singularityMap.empty()) return;
 
 	for (ImageArea area : areas)
 	{
 		bool containsSingularity = false;
 
-		for (cv::Point block : area.getPoints())
+		for (const cv::Point& block : area.getPoints())
 		{
 			if (singularityMap.at<int>(block.y, block.x) == CORE_OR_DELTA) {
 				containsSingularity = true;
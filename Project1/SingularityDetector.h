@@ -1,5 +1,6 @@
 #pragma once
 #include "Image.h"
+#include "BlockGrid.h"
 
 
 class SingularityDetector
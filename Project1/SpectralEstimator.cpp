@@ -0,0 +1,165 @@
+#include "SpectralEstimator.h"
+#include "OrientationsEstimator.h"
+#include "FrequencyEstimator.h"
+#include "FieldQuantizer.h"
+
+
+SpectralEstimator::SpectralEstimator()
+{
+	this->windowSize = 0;
+}
+
+
+//window of block neighborhood with the same width as x-signature window, sized for fast dft
+void SpectralEstimator::setup(Image* image)
+{
+	this->windowSize = cv::getOptimalDFTSize(image->getWindowWidth());
+	cv::createHanningWindow(this->window, cv::Size(this->windowSize, this->windowSize), CV_32F);
+}
+
+
+/**
+ * tensor of wave vectors weighted by power in ridge frequency band gives orientation
+ * the same way as gradient tensor, peak of the band with its neighbors gives frequency
+ */
+bool SpectralEstimator::estimateBlock(double* Vx, double* Vy, double* frequency)
+{
+	int size = this->windowSize;
+	//longer periods do not fit twice into the window and cannot form a peak
+	double maxPeriod = min(PERIOD_MAX, size / 2.);
+	double minRadius = size / maxPeriod;
+	double maxRadius = size / SPECTRAL_MIN_PERIOD;
+
+	//remove mean so that zero frequency does not leak into band, then apply window
+	cv::Scalar mean = cv::mean(this->patch);
+	cv::subtract(this->patch, mean, this->patch);
+	cv::multiply(this->patch, this->window, this->patch);
+
+	cv::dft(this->patch, this->spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+	//power of upper half plane is enough, spectrum of real image is symmetric
+	this->power.create(size / 2 + 1, size, CV_64F);
+	double bandEnergy = 0., peakPower = 0.;
+	int peakU = 0, peakV = 0;
+	*Vx = 0.;
+	*Vy = 0.;
+
+	for (int row = 0; row <= size / 2; row++)
+	{
+		const cv::Vec2f* spectrumRow = this->spectrum.ptr<cv::Vec2f>(row);
+		double* powerRow = this->power.ptr<double>(row);
+
+		for (int col = 0; col < size; col++)
+		{
+			int u = (col <= size / 2) ? col : col - size;
+			int v = row;
+			double radius = sqrt(static_cast<double>(u * u + v * v));
+
+			powerRow[col] = 0.;
+			if (radius < minRadius || radius > maxRadius)
+				continue;
+
+			//first row and middle row of even size are symmetric to themselves, each cell is counted once
+			if ((v == 0 || 2 * v == size) && u < 0)
+				continue;
+
+			double re = spectrumRow[col][0];
+			double im = spectrumRow[col][1];
+			double cellPower = re * re + im * im;
+			powerRow[col] = cellPower;
+			bandEnergy += cellPower;
+
+			*Vx += 2. * u * v * cellPower / (radius * radius);
+			*Vy += (u * u - v * v) * cellPower / (radius * radius);
+
+			if (cellPower > peakPower)
+			{
+				peakPower = cellPower;
+				peakU = u;
+				peakV = v;
+			}
+		}
+	}
+
+	if (bandEnergy <= 0.)
+		return false;
+
+	//power weighted radius of peak and its neighbors, cells outside of stored half plane
+	//are read from their conjugate (-u, -v), which has the same power
+	double peakEnergy = 0., weightedRadius = 0.;
+	for (int v = peakV - 1; v <= peakV + 1; v++)
+	{
+		for (int u = peakU - 1; u <= peakU + 1; u++)
+		{
+			int cellU = u, cellV = v;
+			if (cellV < 0 || ((cellV == 0 || 2 * cellV == size) && cellU < 0))
+			{
+				cellU = -cellU;
+				cellV = (2 * cellV == size) ? cellV : -cellV;
+			}
+
+			if (cellV > size / 2 || abs(cellU) > size / 2)
+				continue;
+
+			double cellPower = this->power.at<double>(cellV, (cellU + size) % size);
+			peakEnergy += cellPower;
+			weightedRadius += cellPower * sqrt(static_cast<double>(u * u + v * v));
+		}
+	}
+
+	if (peakEnergy < SPECTRAL_MIN_PEAK_ENERGY * bandEnergy)
+		return false;
+
+	*frequency = weightedRadius / peakEnergy / size;
+	return true;
+}
+
+
+/**
+ * fills non smoothed orientation field, orientation vectors and frequency field like
+ * OrientationsEstimator::computeOrientationField and FrequencyEstimator::computeFrequencyField
+ * blocks without clear peak get frequency -1 and are interpolated from neighbors
+ */
+void SpectralEstimator::computeFields(Image* image)
+{
+	setup(image);
+
+	const cv::Mat& img = image->getProcessedImage();
+	int blockSize = image->getBlockSize();
+	int blocksX = img.cols / blockSize;
+	int blocksY = img.rows / blockSize;
+
+	BlockGrid<double> orientationField(blocksX, blocksY, 0.);
+	BlockGrid<double> thetaX(blocksX, blocksY, 1.);
+	BlockGrid<double> thetaY(blocksX, blocksY, 0.);
+	BlockGrid<double> frequencyField(blocksX, blocksY, -1.);
+
+	for (const cv::Point& block : image->getForegroundBlocks().getBlocks())
+	{
+		//neighborhood centered on block, border pixels are replicated
+		cv::Point2f blockCenter(block.x * blockSize + (blockSize - 1) / 2.f, block.y * blockSize + (blockSize - 1) / 2.f);
+		cv::getRectSubPix(img, cv::Size(this->windowSize, this->windowSize), blockCenter, this->patch, CV_32F);
+
+		double Vx, Vy, frequency;
+		bool peakFound = estimateBlock(&Vx, &Vy, &frequency);
+
+		orientationField(block) = OrientationsEstimator::orientationFromTensor(Vx, Vy, &thetaX(block), &thetaY(block));
+		if (peakFound)
+			frequencyField(block) = frequency;
+	}
+
+	auto oEstimator = OrientationsEstimator();
+	cv::Mat orientationFieldMat = orientationField.getMat();
+	cv::Mat thetaXMat = thetaX.getMat();
+	cv::Mat thetaYMat = thetaY.getMat();
+	oEstimator.smoothenFingerPrintBordersOrientations(&orientationFieldMat, &thetaXMat, &thetaYMat, image->getBackgroundMask());
+
+	thetaXMat.copyTo(image->thetaX);
+	thetaYMat.copyTo(image->thetaY);
+	image->setNonSmoothedOrientationField(orientationFieldMat);
+	image->setOrientationField(orientationFieldMat);
+
+	auto fEstimator = FrequencyEstimator();
+	fEstimator.interpolateFreqField(img, frequencyField.getMat(), blockSize, image->getForegroundBlocks());
+	image->setFrequencyField(frequencyField.getMat());
+}
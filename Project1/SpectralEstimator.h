@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Image.h"
+#include "BlockGrid.h"
+
+//shortest ridge period searched in spectrum, in pixels
+//longest one is PERIOD_MAX of stored fields, limited by window size
+#define SPECTRAL_MIN_PERIOD 3.
+//part of band energy that has to be around the peak, otherwise frequency is left for interpolation
+#define SPECTRAL_MIN_PEAK_ENERGY 0.1
+
+/**
+ * orientation and frequency of every block from power spectrum of windowed block neighborhood,
+ * both fields are estimated in one step instead of gradients and x-signatures
+ */
+class SpectralEstimator
+{
+private:
+	int windowSize;
+	cv::Mat window;
+	cv::Mat patch;
+	cv::Mat spectrum;
+	cv::Mat power;
+
+	void setup(Image* image);
+	bool estimateBlock(double* Vx, double* Vy, double* frequency);
+
+public:
+	SpectralEstimator();
+	void computeFields(Image* image);
+};
@@ -3,11 +3,40 @@
 
 using namespace std;
 
-int main()
+/**
+ * without arguments processes Images/1.bmp - Images/9.bmp
+ * "pack <output> <images...>" packs images to one file, "<file>" processes packed images,
+ * "<file> <bundle>" also writes fields of processed images to bundle
+ */
+int main(int argc, char** argv)
 {
-	Image* image;
 	auto processingPipeline = new ProcessingPipeline();
 
+	if (argc > 2 && string(argv[1]) == "pack")
+	{
+		vector<string> imagePaths(argv + 3, argv + argc);
+		return ImagePack::pack(argv[2], imagePaths) ? 0 : 1;
+	}
+
+	//optional second argument is file for block fields of processed images
+	if (argc == 2 || argc == 3)
+	{
+		if (argc == 3)
+			processingPipeline->setFieldBundleOutput(argv[2]);
+
+		ImagePack pack;
+		if (!pack.open(argv[1]))
+		{
+			cout << "cannot open image pack " << argv[1] << endl;
+			return 1;
+		}
+
+		processingPipeline->processPack(pack);
+		return 0;
+	}
+
+	vector<string> imagePaths;
+
 	int images = 9;
 
     for(int i = 1; i <= images; i++)
@@ -16,16 +45,11 @@ int main()
 		imageName.append(std::to_string(i));
 		imageName.append(".bmp");
 
-		try {
-			image = new Image(imread(imageName, cv::IMREAD_GRAYSCALE));
-			processingPipeline->processImage(image);
-			cv::waitKey();
-		}
-        catch(...)
-        {
-        }
+		//images are loaded by the batch when their job starts
+		imagePaths.push_back(imageName);
     }
 
-	cv::waitKey(100000);
+	processingPipeline->processBatch(imagePaths);
+
     return 0;
 }